@@ -0,0 +1,292 @@
+// AES-NI and PCLMULQDQ backends for the host build.
+//
+//   AESNI128 aes;             // BlockCipher, like AES128 from Crypto
+//   CTR<AESNI128> ctr;        // so it fits CTR<>, GCM<>, XTS<>, ...
+//   ClmulGCM<AESNI128> gcm;   // GCM with a carry-less multiply GHASH
+//
+// The CPU is asked once (CPUID) whether it has the instructions. Without
+// them, on other architectures or with AESNI_PORTABLE=1, AESNI<T> forwards
+// every call to the portable T it wraps and GHASHClmul falls back to the
+// 4-bit table GHASH from TableGCM.h, so one binary runs on every host. The
+// intrinsics are enabled per function, no -maes is needed.
+#ifndef AESNI_H
+#define AESNI_H
+
+#include <AES.h>
+#include <Arduino.h>
+#include <BlockCipher.h>
+#include <Crypto.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "TableGCM.h"
+
+#ifndef AESNI_PORTABLE
+#define AESNI_PORTABLE 0
+#endif
+
+#if !AESNI_PORTABLE && (defined(__x86_64__) || defined(__i386__)) && \
+    defined(__GNUC__)
+#define AESNI_X86 1
+#else
+#define AESNI_X86 0
+#endif
+
+#if AESNI_X86
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define AESNI_TARGET __attribute__((target("sse2,aes")))
+#define CLMUL_TARGET __attribute__((target("sse2,ssse3,pclmul")))
+
+inline uint32_t aesniCpuFeatures() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return 0;
+  }
+  return ecx;
+}
+
+inline bool aesniSupported() {
+  static const bool supported = (aesniCpuFeatures() & bit_AES) != 0;
+  return supported;
+}
+
+inline bool clmulSupported() {
+  static const bool supported =
+      (aesniCpuFeatures() & (bit_PCLMUL | bit_SSSE3)) ==
+      (bit_PCLMUL | bit_SSSE3);
+  return supported;
+}
+
+// SubWord() of the key schedule: with the word in every column ShiftRows
+// is a no-op, so AESENCLAST with a zero round key is just SubBytes.
+AESNI_TARGET inline uint32_t aesniSubWord(uint32_t word) {
+  __m128i value = _mm_set1_epi32((int)word);
+  value = _mm_aesenclast_si128(value, _mm_setzero_si128());
+  return (uint32_t)_mm_cvtsi128_si32(value);
+}
+
+// FIPS-197 key expansion for keyWords = 4, 6 or 8, on little-endian words,
+// plus the decryption schedule for AESDEC (InvMixColumns on inner rounds).
+AESNI_TARGET inline void aesniExpandKey(const uint8_t* key, size_t keyWords,
+                                        uint8_t* encKey, uint8_t* decKey) {
+  size_t rounds = keyWords + 6;
+  size_t words = 4 * (rounds + 1);
+  uint32_t w[60];
+  uint32_t rcon = 0x01;
+  memcpy(w, key, 4 * keyWords);
+  for (size_t i = keyWords; i < words; i++) {
+    uint32_t temp = w[i - 1];
+    if (i % keyWords == 0) {
+      temp = aesniSubWord((temp >> 8) | (temp << 24)) ^ rcon;
+      rcon = ((rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0)) & 0xFF;
+    } else if (keyWords == 8 && i % keyWords == 4) {
+      temp = aesniSubWord(temp);
+    }
+    w[i] = w[i - keyWords] ^ temp;
+  }
+  memcpy(encKey, w, 4 * words);
+  clean(w, sizeof(w));
+
+  for (size_t round = 0; round <= rounds; round++) {
+    const uint8_t* roundKey = encKey + 16 * (rounds - round);
+    __m128i k = _mm_loadu_si128((const __m128i*)roundKey);
+    if (round != 0 && round != rounds) {
+      k = _mm_aesimc_si128(k);
+    }
+    _mm_storeu_si128((__m128i*)(decKey + 16 * round), k);
+  }
+}
+
+AESNI_TARGET inline void aesniEncrypt(const uint8_t* encKey, size_t rounds,
+                                      uint8_t* output, const uint8_t* input) {
+  const __m128i* rk = (const __m128i*)encKey;
+  __m128i state = _mm_xor_si128(_mm_loadu_si128((const __m128i*)input),
+                                _mm_loadu_si128(rk));
+  for (size_t round = 1; round < rounds; round++) {
+    state = _mm_aesenc_si128(state, _mm_loadu_si128(rk + round));
+  }
+  state = _mm_aesenclast_si128(state, _mm_loadu_si128(rk + rounds));
+  _mm_storeu_si128((__m128i*)output, state);
+}
+
+AESNI_TARGET inline void aesniDecrypt(const uint8_t* decKey, size_t rounds,
+                                      uint8_t* output, const uint8_t* input) {
+  const __m128i* rk = (const __m128i*)decKey;
+  __m128i state = _mm_xor_si128(_mm_loadu_si128((const __m128i*)input),
+                                _mm_loadu_si128(rk));
+  for (size_t round = 1; round < rounds; round++) {
+    state = _mm_aesdec_si128(state, _mm_loadu_si128(rk + round));
+  }
+  state = _mm_aesdeclast_si128(state, _mm_loadu_si128(rk + rounds));
+  _mm_storeu_si128((__m128i*)output, state);
+}
+
+// x = x * h in GF(2^128) with GCM's bit order (Intel's carry-less
+// multiplication white paper, algorithm 1 with the shift-left reduction).
+// Both operands are byte-reversed so the bits are in PCLMULQDQ order.
+CLMUL_TARGET inline void clmulMult(uint8_t* x, const uint8_t* h) {
+  const __m128i reverse =
+      _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)x), reverse);
+  __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)h), reverse);
+
+  // 256-bit product lo:hi by schoolbook multiplication.
+  __m128i lo = _mm_clmulepi64_si128(a, b, 0x00);
+  __m128i hi = _mm_clmulepi64_si128(a, b, 0x11);
+  __m128i mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10),
+                              _mm_clmulepi64_si128(a, b, 0x01));
+  lo = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+  hi = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+  // The operands are bit-reflected, so the product is one bit short:
+  // shift the 256-bit value left by one.
+  __m128i loCarry = _mm_srli_epi32(lo, 31);
+  __m128i hiCarry = _mm_srli_epi32(hi, 31);
+  lo = _mm_slli_epi32(lo, 1);
+  hi = _mm_slli_epi32(hi, 1);
+  __m128i crossCarry = _mm_srli_si128(loCarry, 12);
+  hiCarry = _mm_slli_si128(hiCarry, 4);
+  loCarry = _mm_slli_si128(loCarry, 4);
+  lo = _mm_or_si128(lo, loCarry);
+  hi = _mm_or_si128(hi, _mm_or_si128(hiCarry, crossCarry));
+
+  // Reduce modulo x^128 + x^7 + x^2 + x + 1.
+  __m128i t = _mm_xor_si128(
+      _mm_xor_si128(_mm_slli_epi32(lo, 31), _mm_slli_epi32(lo, 30)),
+      _mm_slli_epi32(lo, 25));
+  __m128i carry = _mm_srli_si128(t, 4);
+  lo = _mm_xor_si128(lo, _mm_slli_si128(t, 12));
+  __m128i u = _mm_xor_si128(
+      _mm_xor_si128(_mm_srli_epi32(lo, 1), _mm_srli_epi32(lo, 2)),
+      _mm_xor_si128(_mm_srli_epi32(lo, 7), carry));
+  hi = _mm_xor_si128(hi, _mm_xor_si128(lo, u));
+
+  _mm_storeu_si128((__m128i*)x, _mm_shuffle_epi8(hi, reverse));
+}
+#else
+inline bool aesniSupported() { return false; }
+inline bool clmulSupported() { return false; }
+#endif
+
+// AES on the AES-NI instructions; Portable (AES128, AES192 or AES256) sets
+// the key size and takes over when the CPU lacks them.
+template <typename Portable>
+class AESNI : public BlockCipher {
+ public:
+  AESNI() : rounds(0), hardware(aesniSupported()) {}
+  virtual ~AESNI() { clear(); }
+
+  size_t blockSize() const { return 16; }
+  size_t keySize() const { return portable.keySize(); }
+
+  // True if the instructions are used, false if Portable runs instead.
+  bool accelerated() const { return hardware; }
+
+  bool setKey(const uint8_t* key, size_t len) {
+#if AESNI_X86
+    if (hardware) {
+      if (len != keySize()) {
+        return false;
+      }
+      aesniExpandKey(key, len / 4, encKey, decKey);
+      rounds = len / 4 + 6;
+      return true;
+    }
+#endif
+    return portable.setKey(key, len);
+  }
+
+  void encryptBlock(uint8_t* output, const uint8_t* input) {
+#if AESNI_X86
+    if (hardware) {
+      aesniEncrypt(encKey, rounds, output, input);
+      return;
+    }
+#endif
+    portable.encryptBlock(output, input);
+  }
+
+  void decryptBlock(uint8_t* output, const uint8_t* input) {
+#if AESNI_X86
+    if (hardware) {
+      aesniDecrypt(decKey, rounds, output, input);
+      return;
+    }
+#endif
+    portable.decryptBlock(output, input);
+  }
+
+  void clear() {
+    clean(encKey, sizeof(encKey));
+    clean(decKey, sizeof(decKey));
+    portable.clear();
+  }
+
+ private:
+  Portable portable;
+  uint8_t encKey[15 * 16];
+  uint8_t decKey[15 * 16];
+  size_t rounds;
+  bool hardware;
+};
+
+typedef AESNI<AES128> AESNI128;
+typedef AESNI<AES192> AESNI192;
+typedef AESNI<AES256> AESNI256;
+
+// GHASH multiplier for TableGCMCommon: one PCLMULQDQ multiply per block,
+// GHASHTable<4> without the instruction.
+class GHASHClmul {
+ public:
+  GHASHClmul() : hardware(clmulSupported()) {}
+
+  void init(const byte* h) {
+    if (hardware) {
+      memcpy(hash, h, sizeof(hash));
+    } else {
+      fallback.init(h);
+    }
+  }
+
+  void mult(byte* x) const {
+#if AESNI_X86
+    if (hardware) {
+      clmulMult(x, hash);
+      return;
+    }
+#endif
+    fallback.mult(x);
+  }
+
+  void clear() {
+    clean(hash, sizeof(hash));
+    fallback.clear();
+  }
+
+ private:
+  byte hash[16];
+  GHASHTable<4> fallback;
+  bool hardware;
+};
+
+template <typename T>
+class ClmulGCM : public TableGCMCommon<GHASHClmul> {
+ public:
+  ClmulGCM() { this->setBlockCipher(&cipher); }
+
+ private:
+  T cipher;
+};
+
+// Prints which of the instructions this CPU has, i.e. what AESNI<T> and
+// ClmulGCM<T> measure.
+inline void printAESNIInfo() {
+  Serial.print("AES-NI: ");
+  Serial.print(aesniSupported() ? "yes" : "no (portable AES)");
+  Serial.print(", PCLMULQDQ: ");
+  Serial.println(clmulSupported() ? "yes" : "no (4-bit table GHASH)");
+}
+
+#endif
@@ -0,0 +1,106 @@
+// Fixed, aligned buffer arena sized at compile time, instead of new/delete
+// for the test vectors.
+//
+//   Arena<2 * 8192> arena;
+//   byte* plaintext = arena.alloc<byte>(len);   // NULL once it is full
+//   byte* ciphertext = arena.alloc<byte>(len);
+//   arena.reset();                               // all buffers at once
+//
+// Every buffer starts at a multiple of Align bytes. Nothing is returned to
+// the heap, so changing the payload size between runs neither fragments
+// the ESP8266 heap nor times the allocator. printHeapReport() shows free
+// heap, the largest free block and fragmentation around a run.
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#if defined(__GLIBC__) && !defined(ARDUINO_NATIVE_H)
+#include <malloc.h>
+#endif
+
+#ifndef ARENA_ALIGN
+#define ARENA_ALIGN 16
+#endif
+
+template <size_t Bytes, size_t Align = ARENA_ALIGN>
+class Arena {
+ public:
+  Arena() : used(0), peak(0) {}
+
+  static size_t capacity() { return Bytes; }
+  size_t usedBytes() const { return used; }
+  size_t peakBytes() const { return peak; }
+
+  // count elements of T, aligned to Align; NULL if the arena is exhausted.
+  template <typename T>
+  T* alloc(size_t count) {
+    size_t start = (used + Align - 1) / Align * Align;
+    if (start > Bytes || count > (Bytes - start) / sizeof(T)) {
+      return NULL;
+    }
+    used = start + count * sizeof(T);
+    if (used > peak) {
+      peak = used;
+    }
+    return (T*)(storage + start);
+  }
+
+  void reset() { used = 0; }
+
+ private:
+  alignas(Align) uint8_t storage[Bytes];
+  size_t used;
+  size_t peak;
+};
+
+// One line on the state of the heap, e.g. "Heap Before Run: 38112 bytes
+// free, largest block 37880 bytes, 1% fragmentation" on the ESP8266. The
+// host shim only knows the bytes in use, AVR the gap between heap and
+// stack.
+inline void printHeapReport(const char* when) {
+  Serial.print("Heap ");
+  Serial.print(when);
+  Serial.print(": ");
+#if defined(ESP8266)
+  Serial.print((unsigned long)ESP.getFreeHeap());
+  Serial.print(" bytes free, largest block ");
+  Serial.print((unsigned long)ESP.getMaxFreeBlockSize());
+  Serial.print(" bytes, ");
+  Serial.print((unsigned long)ESP.getHeapFragmentation());
+  Serial.println("% fragmentation");
+#elif defined(__AVR__)
+  extern char* __brkval;
+  extern char __heap_start;
+  char top;
+  char* heapEnd = __brkval != NULL ? __brkval : &__heap_start;
+  Serial.print((unsigned long)(&top - heapEnd));
+  Serial.println(" bytes free");
+#elif defined(ARDUINO_NATIVE_H)
+  Serial.print((unsigned long)nativeHeapInUse());
+  Serial.println(" bytes in use");
+#elif defined(__GLIBC__)
+  struct mallinfo2 info = mallinfo2();
+  Serial.print((unsigned long)info.uordblks);
+  Serial.print(" bytes in use, ");
+  Serial.print((unsigned long)info.fordblks);
+  Serial.println(" bytes free");
+#else
+  Serial.println("n/a");
+#endif
+}
+
+// Static RAM of an arena and how much of it a run used, e.g. "Arena: 16384
+// bytes static RAM, 16384 bytes used at peak". The arena is in .bss, so
+// printHeapReport() does not see it.
+template <size_t Bytes, size_t Align>
+void printArenaReport(const Arena<Bytes, Align>& arena) {
+  Serial.print("Arena: ");
+  Serial.print((unsigned long)arena.capacity());
+  Serial.print(" bytes static RAM, ");
+  Serial.print((unsigned long)arena.peakBytes());
+  Serial.println(" bytes used at peak");
+}
+
+#endif
@@ -0,0 +1,198 @@
+// CTR that turns a batch of counter blocks into keystream at a time.
+//
+//   BatchCTR<AES128, 16> ctr;   // same API as CTR<AES128>
+//
+// CTRCommon encrypts one counter block per 16 bytes and XORs byte by byte.
+// Here up to Batch counter blocks are written into a keystream buffer and
+// encrypted in one go (a single batch for BitsliceAES, a tight loop for
+// other block ciphers), and the XOR runs a word at a time: 32 bits on the
+// ESP8266, 128-bit vectors on the host. Only as many blocks as the call
+// still needs are generated, so short messages pay for no unused keystream;
+// leftover keystream carries over to the next encrypt() like in CTRCommon.
+// The counter is the last setCounterSize() bytes of the IV, big-endian,
+// wrapping within those bytes (4 by default, as in CTRCommon).
+#ifndef BATCH_CTR_H
+#define BATCH_CTR_H
+
+#include <Arduino.h>
+#include <BlockCipher.h>
+#include <Cipher.h>
+#include <Crypto.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef BATCH_CTR_BLOCKS
+#define BATCH_CTR_BLOCKS 8
+#endif
+
+// Word for the keystream XOR, and whether it may be loaded unaligned.
+#if defined(ESP8266) || defined(__AVR__)
+typedef uint32_t BatchCTRWord __attribute__((may_alias));
+#define BATCH_CTR_UNALIGNED 0
+#else
+typedef uint64_t BatchCTRWord
+    __attribute__((vector_size(16), may_alias));
+#define BATCH_CTR_UNALIGNED 1
+#endif
+
+// output = input ^ keystream for len bytes.
+inline void batchCTRXor(uint8_t* output, const uint8_t* input,
+                        const uint8_t* keystream, size_t len) {
+  const size_t size = sizeof(BatchCTRWord);
+  uintptr_t addresses =
+      (uintptr_t)output | (uintptr_t)input | (uintptr_t)keystream;
+  if (addresses % size == 0) {
+    for (; len >= size; len -= size) {
+      *(BatchCTRWord*)output =
+          *(const BatchCTRWord*)input ^ *(const BatchCTRWord*)keystream;
+      output += size;
+      input += size;
+      keystream += size;
+    }
+  }
+#if BATCH_CTR_UNALIGNED
+  for (; len >= size; len -= size) {
+    BatchCTRWord a, b;
+    memcpy(&a, input, size);
+    memcpy(&b, keystream, size);
+    a ^= b;
+    memcpy(output, &a, size);
+    output += size;
+    input += size;
+    keystream += size;
+  }
+#endif
+  while (len-- > 0) {
+    *output++ = *input++ ^ *keystream++;
+  }
+}
+
+// Encrypts count consecutive blocks of data in place. Block ciphers that
+// can do several blocks at once overload this for their class.
+inline void batchEncryptBlocks(BlockCipher& cipher, uint8_t* data,
+                               size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    cipher.encryptBlock(data + 16 * i, data + 16 * i);
+  }
+}
+
+template <size_t Batch>
+class BatchCTRCommon : public Cipher {
+ public:
+  static const size_t batchBlocks = Batch;
+
+  BatchCTRCommon()
+      : blockCipher(NULL), posn(0), available(0), counterStart(12) {}
+  // The block cipher belongs to BatchCTR<T> and is already gone here.
+  virtual ~BatchCTRCommon() {
+    clean(counter, sizeof(counter));
+    clean(keystream.bytes, sizeof(keystream));
+  }
+
+  size_t keySize() const { return blockCipher->keySize(); }
+  size_t ivSize() const { return 16; }
+
+  bool setCounterSize(size_t size) {
+    if (size < 1 || size > 16) {
+      return false;
+    }
+    counterStart = 16 - size;
+    return true;
+  }
+
+  bool setKey(const uint8_t* key, size_t len) {
+    return blockCipher->setKey(key, len);
+  }
+
+  bool setIV(const uint8_t* iv, size_t len) {
+    if (len != 16) {
+      return false;
+    }
+    memcpy(counter, iv, 16);
+    posn = 0;
+    available = 0;
+    return true;
+  }
+
+  void encrypt(uint8_t* output, const uint8_t* input, size_t len) {
+    while (len > 0) {
+      if (posn == available) {
+        refill(len);
+      }
+      size_t n = available - posn;
+      if (n > len) {
+        n = len;
+      }
+      batchCTRXor(output, input, keystream.bytes + posn, n);
+      posn += n;
+      output += n;
+      input += n;
+      len -= n;
+    }
+  }
+
+  void decrypt(uint8_t* output, const uint8_t* input, size_t len) {
+    encrypt(output, input, len);
+  }
+
+  void clear() {
+    blockCipher->clear();
+    clean(counter, sizeof(counter));
+    clean(keystream.bytes, sizeof(keystream));
+    posn = 0;
+    available = 0;
+  }
+
+ protected:
+  void setBlockCipher(BlockCipher* cipher) { blockCipher = cipher; }
+
+  // Encrypts count <= Batch counter blocks in place.
+  virtual void encryptBlocks(uint8_t* data, size_t count) = 0;
+
+ private:
+  // Keystream for the next len bytes, at most a batch of it.
+  void refill(size_t len) {
+    size_t count = (len + 15) / 16;
+    if (count > Batch) {
+      count = Batch;
+    }
+    for (size_t block = 0; block < count; block++) {
+      memcpy(keystream.bytes + 16 * block, counter, 16);
+      for (int i = 15; i >= counterStart; i--) {
+        if (++counter[i] != 0) {
+          break;
+        }
+      }
+    }
+    encryptBlocks(keystream.bytes, count);
+    posn = 0;
+    available = 16 * count;
+  }
+
+  BlockCipher* blockCipher;
+  uint8_t counter[16];
+  // Word aligned for batchCTRXor().
+  union {
+    uint8_t bytes[16 * Batch];
+    BatchCTRWord words[16 * Batch / sizeof(BatchCTRWord)];
+  } keystream;
+  size_t posn;
+  size_t available;
+  int counterStart;
+};
+
+template <typename T, size_t Batch = BATCH_CTR_BLOCKS>
+class BatchCTR : public BatchCTRCommon<Batch> {
+ public:
+  BatchCTR() { this->setBlockCipher(&cipher); }
+
+ protected:
+  void encryptBlocks(uint8_t* data, size_t count) {
+    batchEncryptBlocks(cipher, data, count);
+  }
+
+ private:
+  T cipher;
+};
+
+#endif
@@ -0,0 +1,522 @@
+// Compile-time benchmark matrix shared by the suites.
+//
+// A suite describes the cells it wants once, e.g.
+//
+//   typedef Matrix<Modes<ECBMode, CTRMode, GCMMode>,
+//                  Ciphers<AES128, AES192, AES256>> Suite;
+//   Suite::run(experiment);
+//
+// and Matrix instantiates one cipher object per {mode x cipher} cell and hands
+// it to the suite's experiment functor, which only has to be written once:
+//
+//   struct Experiment {
+//     template <typename T>
+//     void operator()(T& cipher, const char* name);
+//   };
+//
+// A third argument adds the payload dimension: with
+//
+//   typedef Matrix<Modes<CTRMode>, Ciphers<AES128>, Sizes<1024, 4096>> Suite;
+//
+// the functor takes (T& cipher, const char* name, size_t len) and is called
+// for every size of a cell before the next cell.
+//
+// The bench*() overloads below hide the API differences between raw block
+// ciphers, stream/AEAD modes and XTS so one experiment body fits every cell.
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <AES.h>
+#include <Arduino.h>
+#include <CTR.h>
+#include <Crypto.h>
+#include <EAX.h>
+#include <GCM.h>
+#include <XTS.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "BatchCTR.h"
+#include "BitsliceAES.h"
+#include "TableGCM.h"
+#include "Timer.h"
+
+#if defined(__AVR__)
+#include <new.h>
+#else
+#include <new>
+#endif
+
+// Untimed calls made before a steady-state series, so the first sample is
+// not paying for cache misses and first-touch key schedules.
+#ifndef BENCH_WARMUP_ITERATIONS
+#define BENCH_WARMUP_ITERATIONS 1
+#endif
+
+// Number of cold-start samples; each one re-instantiates the cipher object.
+#ifndef BENCH_COLD_RUNS
+#define BENCH_COLD_RUNS 10
+#endif
+
+// Set to 1 to also evict caches before every cold-start sample (flash cache
+// on the ESP8266, data caches on the host; the AVR boards have none).
+#ifndef BENCH_EVICT_CACHES
+#define BENCH_EVICT_CACHES 0
+#endif
+
+// Bytes streamed through to evict caches: more than the ESP8266's 32 KB
+// flash cache, more than the last-level cache of typical hosts.
+#ifndef BENCH_EVICT_BYTES
+#if defined(ESP8266)
+#define BENCH_EVICT_BYTES 40960
+#else
+#define BENCH_EVICT_BYTES (64UL * 1024 * 1024)
+#endif
+#endif
+
+// Adds the T-table AES (TTableAES.h, 32-bit targets only) next to the library
+// AES in every suite.
+#ifndef BENCH_TTABLE_AES
+#define BENCH_TTABLE_AES 0
+#endif
+
+// Adds the AES-NI backend (AESNI.h) and, in the GCM suites, the PCLMULQDQ
+// GHASH. Meant for the native builds; elsewhere it measures the fallback.
+#ifndef BENCH_AESNI
+#define BENCH_AESNI 0
+#endif
+
+#if BENCH_TTABLE_AES
+#include "TTableAES.h"
+#define BENCH_TTABLE_CIPHERS , TTableAES128, TTableAES192, TTableAES256
+#else
+#define BENCH_TTABLE_CIPHERS
+#endif
+
+#if BENCH_AESNI
+#include "AESNI.h"
+#define BENCH_AESNI_CIPHERS , AESNI128, AESNI192, AESNI256
+#else
+#define BENCH_AESNI_CIPHERS
+#endif
+
+// The Ciphers<> list for the suites.
+#define BENCH_CIPHERS \
+  AES128, AES192, AES256 BENCH_TTABLE_CIPHERS BENCH_AESNI_CIPHERS
+
+// Key material for every cell. 64 bytes covers XTS with two AES-256 keys.
+// clang-format off
+static const byte benchKey[64] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
+    0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27,
+    0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F};
+static const byte benchIV[16] = {
+    0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7,
+    0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF};
+// clang-format on
+
+// Display name of a block cipher; specialize for every cipher used in a
+// Ciphers<> list.
+template <typename T>
+struct CipherName;
+
+template <>
+struct CipherName<AES128> {
+  static const char* get() { return "AES-128"; }
+};
+
+template <>
+struct CipherName<AES192> {
+  static const char* get() { return "AES-192"; }
+};
+
+template <>
+struct CipherName<AES256> {
+  static const char* get() { return "AES-256"; }
+};
+
+template <>
+struct CipherName<BitsliceAES128> {
+  static const char* get() { return "BSAES-128"; }
+};
+
+template <>
+struct CipherName<BitsliceAES192> {
+  static const char* get() { return "BSAES-192"; }
+};
+
+template <>
+struct CipherName<BitsliceAES256> {
+  static const char* get() { return "BSAES-256"; }
+};
+
+#if BENCH_TTABLE_AES
+template <>
+struct CipherName<TTableAES128> {
+  static const char* get() { return "TAES-128"; }
+};
+
+template <>
+struct CipherName<TTableAES192> {
+  static const char* get() { return "TAES-192"; }
+};
+
+template <>
+struct CipherName<TTableAES256> {
+  static const char* get() { return "TAES-256"; }
+};
+#endif
+
+#if BENCH_AESNI
+template <>
+struct CipherName<AESNI128> {
+  static const char* get() { return "AESNI-128"; }
+};
+
+template <>
+struct CipherName<AESNI192> {
+  static const char* get() { return "AESNI-192"; }
+};
+
+template <>
+struct CipherName<AESNI256> {
+  static const char* get() { return "AESNI-256"; }
+};
+#endif
+
+// Mode descriptors: Of<T> is the class under test for block cipher T, suffix
+// is appended to the cipher name ("AES-128" + "-CTR").
+struct ECBMode {
+  template <typename T>
+  using Of = T;
+  static const char* suffix() { return ""; }
+};
+
+struct CTRMode {
+  template <typename T>
+  using Of = CTR<T>;
+  static const char* suffix() { return "-CTR"; }
+};
+
+// BatchCTR with Batch counter blocks per keystream refill.
+template <size_t Batch>
+struct BatchCTRMode {
+  template <typename T>
+  using Of = BatchCTR<T, Batch>;
+  static const char* suffix() {
+    static char name[16];
+    snprintf(name, sizeof(name), "-CTR-B%u", (unsigned)Batch);
+    return name;
+  }
+};
+
+struct EAXMode {
+  template <typename T>
+  using Of = EAX<T>;
+  static const char* suffix() { return "-EAX"; }
+};
+
+struct GCMMode {
+  template <typename T>
+  using Of = GCM<T>;
+  static const char* suffix() { return "-GCM"; }
+};
+
+// GCM with table-driven GHASH (TABLE_GCM_BITS wide tables).
+struct TableGCMMode {
+  template <typename T>
+  using Of = TableGCM<T>;
+  static const char* suffix() {
+    return TABLE_GCM_BITS == 8 ? "-GCM-T8" : "-GCM-T4";
+  }
+};
+
+#if BENCH_AESNI
+// GCM with the PCLMULQDQ GHASH.
+struct ClmulGCMMode {
+  template <typename T>
+  using Of = ClmulGCM<T>;
+  static const char* suffix() { return "-GCM-CL"; }
+};
+#endif
+
+struct XTSMode {
+  template <typename T>
+  using Of = XTS<T>;
+  static const char* suffix() { return "-XTS"; }
+};
+
+// Untimed per-cell preparation for a payload of len bytes.
+inline void benchSetSize(BlockCipher& cipher, size_t len) {
+  (void)cipher;
+  (void)len;
+}
+
+inline void benchSetSize(Cipher& cipher, size_t len) {
+  (void)cipher;
+  (void)len;
+}
+
+// XTS processes exactly one sector per call, so the sector is the payload.
+inline void benchSetSize(XTSCommon& cipher, size_t len) {
+  cipher.setSectorSize(len);
+}
+
+inline bool benchSetKey(BlockCipher& cipher, const byte* key) {
+  return cipher.setKey(key, cipher.keySize());
+}
+
+inline bool benchSetKey(Cipher& cipher, const byte* key) {
+  return cipher.setKey(key, cipher.keySize());
+}
+
+inline bool benchSetKey(XTSCommon& cipher, const byte* key) {
+  return cipher.setKey(key, cipher.keySize());
+}
+
+// Untimed per-message setup: IV/nonce for the modes, tweak for XTS.
+inline void benchSetIV(BlockCipher& cipher) { (void)cipher; }
+
+inline void benchSetIV(Cipher& cipher) {
+  cipher.setIV(benchIV, cipher.ivSize());
+}
+
+inline void benchSetIV(XTSCommon& cipher) {
+  cipher.setTweak(benchIV, cipher.tweakSize());
+}
+
+// Whether benchSetIV() does any work for the cell.
+inline bool benchHasIV(BlockCipher& cipher) {
+  (void)cipher;
+  return false;
+}
+
+inline bool benchHasIV(Cipher& cipher) {
+  (void)cipher;
+  return true;
+}
+
+inline bool benchHasIV(XTSCommon& cipher) {
+  (void)cipher;
+  return true;
+}
+
+// ECB over whole blocks; a trailing partial block is left untouched.
+inline void benchEncrypt(BlockCipher& cipher, byte* output, const byte* input,
+                         size_t len) {
+  size_t blockSize = cipher.blockSize();
+  for (size_t i = 0; i + blockSize <= len; i += blockSize) {
+    cipher.encryptBlock(output + i, input + i);
+  }
+}
+
+inline void benchDecrypt(BlockCipher& cipher, byte* output, const byte* input,
+                         size_t len) {
+  size_t blockSize = cipher.blockSize();
+  for (size_t i = 0; i + blockSize <= len; i += blockSize) {
+    cipher.decryptBlock(output + i, input + i);
+  }
+}
+
+inline void benchEncrypt(Cipher& cipher, byte* output, const byte* input,
+                         size_t len) {
+  cipher.encrypt(output, input, len);
+}
+
+inline void benchDecrypt(Cipher& cipher, byte* output, const byte* input,
+                         size_t len) {
+  cipher.decrypt(output, input, len);
+}
+
+inline void benchEncrypt(XTSCommon& cipher, byte* output, const byte* input,
+                         size_t len) {
+  (void)len;
+  cipher.encryptSector(output, input);
+}
+
+inline void benchDecrypt(XTSCommon& cipher, byte* output, const byte* input,
+                         size_t len) {
+  (void)len;
+  cipher.decryptSector(output, input);
+}
+
+// Writes the tag of the message just encrypted and returns its length; 0 for
+// cells without one.
+inline size_t benchTag(BlockCipher& cipher, byte* tag) {
+  (void)cipher;
+  (void)tag;
+  return 0;
+}
+
+inline size_t benchTag(Cipher& cipher, byte* tag) {
+  (void)cipher;
+  (void)tag;
+  return 0;
+}
+
+inline size_t benchTag(AuthenticatedCipher& cipher, byte* tag) {
+  cipher.computeTag(tag, cipher.tagSize());
+  return cipher.tagSize();
+}
+
+inline size_t benchTag(XTSCommon& cipher, byte* tag) {
+  (void)cipher;
+  (void)tag;
+  return 0;
+}
+
+// Prints "<label>: x MB/s, y cycles/byte" for bytes processed in the given
+// number of Timer ticks; cycles are left out if the timer cannot provide them.
+inline void printThroughput(const char* label, unsigned long bytes,
+                            unsigned long ticks) {
+  Serial.print(label);
+  Serial.print(": ");
+  double elapsed = Timer::toMicros(ticks);
+  if (elapsed <= 0) {
+    Serial.println("n/a");
+    return;
+  }
+  Serial.print(bytes / elapsed, 3);
+  Serial.print(" MB/s");
+  if (Timer::hasCycles()) {
+    Serial.print(", ");
+    Serial.print(Timer::toCycles(ticks) / bytes, 1);
+    Serial.print(" cycles/byte");
+  }
+  Serial.println();
+}
+
+// One complete message as a freshly woken device sends it: key schedule,
+// IV/tweak and encryption of len bytes.
+template <typename T>
+inline void benchMessage(T& cipher, byte* output, const byte* input,
+                         size_t len) {
+  benchSetKey(cipher, benchKey);
+  benchSetIV(cipher);
+  benchEncrypt(cipher, output, input, len);
+}
+
+template <typename T>
+inline void benchWarmup(T& cipher, byte* output, const byte* input,
+                        size_t len) {
+  for (int i = 0; i < BENCH_WARMUP_ITERATIONS; i++) {
+    benchMessage(cipher, output, input, len);
+  }
+}
+
+// Destroys and reconstructs cipher in place, dropping its key schedule and
+// any state a previous run left behind.
+template <typename T>
+inline void benchRecreate(T& cipher) {
+  cipher.~T();
+  new (&cipher) T();
+}
+
+inline void benchEvictCaches() {
+#if BENCH_EVICT_CACHES && defined(ESP8266)
+  // Code and PROGMEM data share the flash cache, so reading a larger flash
+  // array displaces the cipher code and its tables.
+  static const byte evictData[BENCH_EVICT_BYTES] PROGMEM = {0};
+  volatile byte sink = 0;
+  for (size_t i = 0; i < BENCH_EVICT_BYTES; i += 16) {
+    sink ^= pgm_read_byte(evictData + i);
+  }
+  (void)sink;
+#elif BENCH_EVICT_CACHES && !defined(__AVR__)
+  static byte* evictData = (byte*)malloc(BENCH_EVICT_BYTES);
+  if (evictData == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < BENCH_EVICT_BYTES; i += 64) {
+    evictData[i]++;
+  }
+#endif
+}
+
+template <typename... Ms>
+struct Modes {};
+
+template <typename... Ts>
+struct Ciphers {};
+
+// Payload sizes in bytes.
+template <size_t... Ns>
+struct Sizes {};
+
+// One statically allocated cipher object per cell, like the per-cell globals
+// (aes128ctr, aes256gcm, ...) the suites used to declare by hand.
+template <typename M, typename T>
+struct Cell {
+  typedef typename M::template Of<T> Type;
+  static Type cipher;
+
+  template <typename F>
+  static void run(F& experiment) {
+    char name[32];
+    strcpy(name, CipherName<T>::get());
+    strcat(name, M::suffix());
+    crypto_feed_watchdog();
+    experiment(cipher, name);
+  }
+
+  template <typename F>
+  static void run(F& experiment, size_t len) {
+    char name[32];
+    strcpy(name, CipherName<T>::get());
+    strcat(name, M::suffix());
+    crypto_feed_watchdog();
+    experiment(cipher, name, len);
+  }
+};
+
+template <typename M, typename T>
+typename Cell<M, T>::Type Cell<M, T>::cipher;
+
+template <typename ModeList, typename CipherList, typename SizeList = Sizes<>>
+struct Matrix;
+
+template <typename... Ms, typename... Ts>
+struct Matrix<Modes<Ms...>, Ciphers<Ts...>, Sizes<>> {
+  // Runs every cell, mode-major: all ciphers of the first mode, then the next.
+  template <typename F>
+  static void run(F& experiment) {
+    int expand[] = {0, (runMode<Ms>(experiment), 0)...};
+    (void)expand;
+  }
+
+  template <typename M, typename F>
+  static void runMode(F& experiment) {
+    int expand[] = {0, (Cell<M, Ts>::run(experiment), 0)...};
+    (void)expand;
+  }
+};
+
+// Every size of a cell in turn, then the next cell, mode-major as above.
+template <typename... Ms, typename... Ts, size_t... Ns>
+struct Matrix<Modes<Ms...>, Ciphers<Ts...>, Sizes<Ns...>> {
+  template <typename F>
+  static void run(F& experiment) {
+    int expand[] = {0, (runMode<Ms>(experiment), 0)...};
+    (void)expand;
+  }
+
+  template <typename M, typename F>
+  static void runMode(F& experiment) {
+    int expand[] = {0, (runCell<M, Ts>(experiment), 0)...};
+    (void)expand;
+  }
+
+  template <typename M, typename T, typename F>
+  static void runCell(F& experiment) {
+    int expand[] = {0, (Cell<M, T>::run(experiment, Ns), 0)...};
+    (void)expand;
+  }
+};
+
+#endif
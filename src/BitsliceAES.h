@@ -0,0 +1,507 @@
+// Bitsliced, constant-time AES over many blocks at once, and CTR on top.
+//
+//   CTR<BitsliceAES128> ctr;   // same API as CTR<AES128>
+//
+// All blocks of a batch go through the rounds together: bit b of every state
+// byte lives in word q[b], SubBytes is a 113-gate Boolean circuit (Boyar and
+// Peralta) and ShiftRows/MixColumns are shifts and rotations of the words.
+// There are no table lookups and no data-dependent branches, so the timing
+// does not depend on key or data. A batch costs the same for one block as
+// for parallelBlocks, which is why CTR<BitsliceAES*> is a BatchCTR that
+// turns a whole batch of counter blocks into keystream at a time.
+// encryptBlock()/decryptBlock() let the other modes use it too, one block
+// per batch.
+//
+// A word is BITSLICE_AES_LANES lanes of 64 bits (GCC vector extensions, SIMD
+// code where the target has it) with four blocks per lane: by default 2
+// lanes or 8 blocks on the ESP8266 and 8 lanes or 32 blocks on the host.
+// Within a lane, bit 16 * row + 4 * column + block holds that state byte.
+#ifndef BITSLICE_AES_H
+#define BITSLICE_AES_H
+
+#include <Arduino.h>
+#include <BlockCipher.h>
+#include <CTR.h>
+#include <Cipher.h>
+#include <Crypto.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "BatchCTR.h"
+
+#if defined(__AVR__)
+#error "BitsliceAES needs a 32-bit target"
+#endif
+
+#ifndef BITSLICE_AES_LANES
+#if defined(ESP8266)
+#define BITSLICE_AES_LANES 2
+#else
+#define BITSLICE_AES_LANES 8
+#endif
+#endif
+
+typedef uint64_t BitsliceWord
+    __attribute__((vector_size(8 * BITSLICE_AES_LANES)));
+
+// Offset of the byte for bit 8 * j + i of a lane within its four blocks,
+// i.e. the input byte that goes to byte j of q[i] before the transpose.
+// clang-format off
+static const uint8_t bitsliceAESOffset[64] = {
+     0, 16, 32, 48,  4, 20, 36, 52,  8, 24, 40, 56, 12, 28, 44, 60,
+     1, 17, 33, 49,  5, 21, 37, 53,  9, 25, 41, 57, 13, 29, 45, 61,
+     2, 18, 34, 50,  6, 22, 38, 54, 10, 26, 42, 58, 14, 30, 46, 62,
+     3, 19, 35, 51,  7, 23, 39, 55, 11, 27, 43, 59, 15, 31, 47, 63};
+// clang-format on
+
+inline void bitsliceAESSbox(BitsliceWord* q) {
+  BitsliceWord x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4];
+  BitsliceWord x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+  // Top linear transformation.
+  BitsliceWord y14 = x3 ^ x5;
+  BitsliceWord y13 = x0 ^ x6;
+  BitsliceWord y9 = x0 ^ x3;
+  BitsliceWord y8 = x0 ^ x5;
+  BitsliceWord t0 = x1 ^ x2;
+  BitsliceWord y1 = t0 ^ x7;
+  BitsliceWord y4 = y1 ^ x3;
+  BitsliceWord y12 = y13 ^ y14;
+  BitsliceWord y2 = y1 ^ x0;
+  BitsliceWord y5 = y1 ^ x6;
+  BitsliceWord y3 = y5 ^ y8;
+  BitsliceWord t1 = x4 ^ y12;
+  BitsliceWord y15 = t1 ^ x5;
+  BitsliceWord y20 = t1 ^ x1;
+  BitsliceWord y6 = y15 ^ x7;
+  BitsliceWord y10 = y15 ^ t0;
+  BitsliceWord y11 = y20 ^ y9;
+  BitsliceWord y7 = x7 ^ y11;
+  BitsliceWord y17 = y10 ^ y11;
+  BitsliceWord y19 = y10 ^ y8;
+  BitsliceWord y16 = t0 ^ y11;
+  BitsliceWord y21 = y13 ^ y16;
+  BitsliceWord y18 = x0 ^ y16;
+
+  // Non-linear section: inversion in GF(2^8).
+  BitsliceWord t2 = y12 & y15;
+  BitsliceWord t3 = y3 & y6;
+  BitsliceWord t4 = t3 ^ t2;
+  BitsliceWord t5 = y4 & x7;
+  BitsliceWord t6 = t5 ^ t2;
+  BitsliceWord t7 = y13 & y16;
+  BitsliceWord t8 = y5 & y1;
+  BitsliceWord t9 = t8 ^ t7;
+  BitsliceWord t10 = y2 & y7;
+  BitsliceWord t11 = t10 ^ t7;
+  BitsliceWord t12 = y9 & y11;
+  BitsliceWord t13 = y14 & y17;
+  BitsliceWord t14 = t13 ^ t12;
+  BitsliceWord t15 = y8 & y10;
+  BitsliceWord t16 = t15 ^ t12;
+  BitsliceWord t17 = t4 ^ t14;
+  BitsliceWord t18 = t6 ^ t16;
+  BitsliceWord t19 = t9 ^ t14;
+  BitsliceWord t20 = t11 ^ t16;
+  BitsliceWord t21 = t17 ^ y20;
+  BitsliceWord t22 = t18 ^ y19;
+  BitsliceWord t23 = t19 ^ y21;
+  BitsliceWord t24 = t20 ^ y18;
+  BitsliceWord t25 = t21 ^ t22;
+  BitsliceWord t26 = t21 & t23;
+  BitsliceWord t27 = t24 ^ t26;
+  BitsliceWord t28 = t25 & t27;
+  BitsliceWord t29 = t28 ^ t22;
+  BitsliceWord t30 = t23 ^ t24;
+  BitsliceWord t31 = t22 ^ t26;
+  BitsliceWord t32 = t31 & t30;
+  BitsliceWord t33 = t32 ^ t24;
+  BitsliceWord t34 = t23 ^ t33;
+  BitsliceWord t35 = t27 ^ t33;
+  BitsliceWord t36 = t24 & t35;
+  BitsliceWord t37 = t36 ^ t34;
+  BitsliceWord t38 = t27 ^ t36;
+  BitsliceWord t39 = t29 & t38;
+  BitsliceWord t40 = t25 ^ t39;
+  BitsliceWord t41 = t40 ^ t37;
+  BitsliceWord t42 = t29 ^ t33;
+  BitsliceWord t43 = t29 ^ t40;
+  BitsliceWord t44 = t33 ^ t37;
+  BitsliceWord t45 = t42 ^ t41;
+  BitsliceWord z0 = t44 & y15;
+  BitsliceWord z1 = t37 & y6;
+  BitsliceWord z2 = t33 & x7;
+  BitsliceWord z3 = t43 & y16;
+  BitsliceWord z4 = t40 & y1;
+  BitsliceWord z5 = t29 & y7;
+  BitsliceWord z6 = t42 & y11;
+  BitsliceWord z7 = t45 & y17;
+  BitsliceWord z8 = t41 & y10;
+  BitsliceWord z9 = t44 & y12;
+  BitsliceWord z10 = t37 & y3;
+  BitsliceWord z11 = t33 & y4;
+  BitsliceWord z12 = t43 & y13;
+  BitsliceWord z13 = t40 & y5;
+  BitsliceWord z14 = t29 & y2;
+  BitsliceWord z15 = t42 & y9;
+  BitsliceWord z16 = t45 & y14;
+  BitsliceWord z17 = t41 & y8;
+
+  // Bottom linear transformation and affine constant.
+  BitsliceWord t46 = z15 ^ z16;
+  BitsliceWord t47 = z10 ^ z11;
+  BitsliceWord t48 = z5 ^ z13;
+  BitsliceWord t49 = z9 ^ z10;
+  BitsliceWord t50 = z2 ^ z12;
+  BitsliceWord t51 = z2 ^ z5;
+  BitsliceWord t52 = z7 ^ z8;
+  BitsliceWord t53 = z0 ^ z3;
+  BitsliceWord t54 = z6 ^ z7;
+  BitsliceWord t55 = z16 ^ z17;
+  BitsliceWord t56 = z12 ^ t48;
+  BitsliceWord t57 = t50 ^ t53;
+  BitsliceWord t58 = z4 ^ t46;
+  BitsliceWord t59 = z3 ^ t54;
+  BitsliceWord t60 = t46 ^ t57;
+  BitsliceWord t61 = z14 ^ t57;
+  BitsliceWord t62 = t52 ^ t58;
+  BitsliceWord t63 = t49 ^ t58;
+  BitsliceWord t64 = z4 ^ t59;
+  BitsliceWord t65 = t61 ^ t62;
+  BitsliceWord t66 = z1 ^ t63;
+  BitsliceWord s0 = t59 ^ t63;
+  BitsliceWord s6 = t56 ^ ~t62;
+  BitsliceWord s7 = t48 ^ ~t60;
+  BitsliceWord t67 = t64 ^ t65;
+  BitsliceWord s3 = t53 ^ t66;
+  BitsliceWord s4 = t51 ^ t66;
+  BitsliceWord s5 = t47 ^ t65;
+  BitsliceWord s1 = t64 ^ ~s3;
+  BitsliceWord s2 = t55 ^ ~t67;
+
+  q[7] = s0;
+  q[6] = s1;
+  q[5] = s2;
+  q[4] = s3;
+  q[3] = s4;
+  q[2] = s5;
+  q[1] = s6;
+  q[0] = s7;
+}
+
+// Inverse S-box as A^-1(S(A^-1(x ^ 0x63)) ^ 0x63), A being the affine map
+// of the forward S-box; the NOTs add the constant.
+inline void bitsliceAESInvAffine(BitsliceWord* q) {
+  BitsliceWord q0 = ~q[0], q1 = ~q[1], q2 = q[2], q3 = q[3];
+  BitsliceWord q4 = q[4], q5 = ~q[5], q6 = ~q[6], q7 = q[7];
+  q[7] = q1 ^ q4 ^ q6;
+  q[6] = q0 ^ q3 ^ q5;
+  q[5] = q7 ^ q2 ^ q4;
+  q[4] = q6 ^ q1 ^ q3;
+  q[3] = q5 ^ q0 ^ q2;
+  q[2] = q4 ^ q7 ^ q1;
+  q[1] = q3 ^ q6 ^ q0;
+  q[0] = q2 ^ q5 ^ q7;
+}
+
+inline void bitsliceAESInvSbox(BitsliceWord* q) {
+  bitsliceAESInvAffine(q);
+  bitsliceAESSbox(q);
+  bitsliceAESInvAffine(q);
+}
+
+inline void bitsliceAESShiftRows(BitsliceWord* q) {
+  for (int i = 0; i < 8; i++) {
+    BitsliceWord x = q[i];
+    q[i] = (x & 0x000000000000FFFFULL) | ((x & 0x00000000FFF00000ULL) >> 4) |
+           ((x & 0x00000000000F0000ULL) << 12) |
+           ((x & 0x0000FF0000000000ULL) >> 8) |
+           ((x & 0x000000FF00000000ULL) << 8) |
+           ((x & 0xF000000000000000ULL) >> 12) |
+           ((x & 0x0FFF000000000000ULL) << 4);
+  }
+}
+
+inline void bitsliceAESInvShiftRows(BitsliceWord* q) {
+  for (int i = 0; i < 8; i++) {
+    BitsliceWord x = q[i];
+    q[i] = (x & 0x000000000000FFFFULL) | ((x & 0x000000000FFF0000ULL) << 4) |
+           ((x & 0x00000000F0000000ULL) >> 12) |
+           ((x & 0x0000FF0000000000ULL) >> 8) |
+           ((x & 0x000000FF00000000ULL) << 8) |
+           ((x & 0x000F000000000000ULL) << 12) |
+           ((x & 0xFFF0000000000000ULL) >> 4);
+  }
+}
+
+// Row r + 1 (rotate 16) or row r + 2 (rotate 32) moved into row r. Macros,
+// as wide vectors are not passed in registers without AVX-512.
+#define BITSLICE_AES_ROTATE16(x) (((x) >> 16) | ((x) << 48))
+#define BITSLICE_AES_ROTATE32(x) (((x) >> 32) | ((x) << 32))
+
+// s'[r] = 2 * (s[r] ^ s[r + 1]) ^ s[r + 1] ^ s[r + 2] ^ s[r + 3], the
+// doubling spread over the bit planes.
+inline void bitsliceAESMixColumns(BitsliceWord* q) {
+  BitsliceWord r[8];
+  BitsliceWord t[8];
+  for (int i = 0; i < 8; i++) {
+    r[i] = BITSLICE_AES_ROTATE16(q[i]);
+    t[i] = q[i] ^ r[i];
+  }
+  q[0] = t[7] ^ r[0] ^ BITSLICE_AES_ROTATE32(t[0]);
+  q[1] = t[0] ^ t[7] ^ r[1] ^ BITSLICE_AES_ROTATE32(t[1]);
+  q[2] = t[1] ^ r[2] ^ BITSLICE_AES_ROTATE32(t[2]);
+  q[3] = t[2] ^ t[7] ^ r[3] ^ BITSLICE_AES_ROTATE32(t[3]);
+  q[4] = t[3] ^ t[7] ^ r[4] ^ BITSLICE_AES_ROTATE32(t[4]);
+  q[5] = t[4] ^ r[5] ^ BITSLICE_AES_ROTATE32(t[5]);
+  q[6] = t[5] ^ r[6] ^ BITSLICE_AES_ROTATE32(t[6]);
+  q[7] = t[6] ^ r[7] ^ BITSLICE_AES_ROTATE32(t[7]);
+}
+
+// InvMixColumns is MixColumns after s'[r] = s[r] ^ 4 * (s[r] ^ s[r + 2]).
+inline void bitsliceAESInvMixColumns(BitsliceWord* q) {
+  BitsliceWord t[8];
+  for (int i = 0; i < 8; i++) {
+    t[i] = q[i] ^ BITSLICE_AES_ROTATE32(q[i]);
+  }
+  // 4 * t: bit i comes from bit i - 2, reduced by 0x11B twice.
+  q[0] ^= t[6];
+  q[1] ^= t[6] ^ t[7];
+  q[2] ^= t[0] ^ t[7];
+  q[3] ^= t[1] ^ t[6];
+  q[4] ^= t[2] ^ t[6] ^ t[7];
+  q[5] ^= t[3] ^ t[7];
+  q[6] ^= t[4];
+  q[7] ^= t[5];
+  bitsliceAESMixColumns(q);
+}
+
+// Transposes the 8x8 bit matrices formed by byte j of q[0..7]: afterwards
+// bit i of byte j of q[b] is bit b of what was byte j of q[i]. Its own
+// inverse.
+template <typename W>
+inline void bitsliceAESOrtho(W* q) {
+  static const uint64_t mask1 = 0x5555555555555555ULL;
+  static const uint64_t mask2 = 0x3333333333333333ULL;
+  static const uint64_t mask4 = 0x0F0F0F0F0F0F0F0FULL;
+  for (int i = 0; i < 8; i += 2) {
+    W a = q[i], b = q[i + 1];
+    q[i] = (a & mask1) | ((b & mask1) << 1);
+    q[i + 1] = ((a >> 1) & mask1) | (b & ~mask1);
+  }
+  for (int i = 0; i < 8; i += 4) {
+    for (int j = i; j < i + 2; j++) {
+      W a = q[j], b = q[j + 2];
+      q[j] = (a & mask2) | ((b & mask2) << 2);
+      q[j + 2] = ((a >> 2) & mask2) | (b & ~mask2);
+    }
+  }
+  for (int j = 0; j < 4; j++) {
+    W a = q[j], b = q[j + 4];
+    q[j] = (a & mask4) | ((b & mask4) << 4);
+    q[j + 4] = ((a >> 4) & mask4) | (b & ~mask4);
+  }
+}
+
+class BitsliceAESCommon : public BlockCipher {
+ public:
+  static const size_t parallelBlocks = 4 * BITSLICE_AES_LANES;
+
+  BitsliceAESCommon() : rounds(0) {}
+  virtual ~BitsliceAESCommon() { clear(); }
+
+  size_t blockSize() const { return 16; }
+
+  void encryptBlock(uint8_t* output, const uint8_t* input) {
+    encryptBlocks(output, input, 1);
+  }
+
+  void decryptBlock(uint8_t* output, const uint8_t* input) {
+    decryptBlocks(output, input, 1);
+  }
+
+  // Encrypts count <= parallelBlocks consecutive blocks in one batch;
+  // output may be input. Without a key both directions leave output alone:
+  // rounds is still 0, and rounds - 1 would walk 255 rounds off the schedule.
+  void encryptBlocks(uint8_t* output, const uint8_t* input, size_t count) {
+    if (rounds == 0) {
+      return;
+    }
+    BitsliceWord q[8];
+    load(q, input, count);
+    addRoundKey(q, 0);
+    for (uint8_t round = 1; round < rounds; round++) {
+      bitsliceAESSbox(q);
+      bitsliceAESShiftRows(q);
+      bitsliceAESMixColumns(q);
+      addRoundKey(q, round);
+    }
+    bitsliceAESSbox(q);
+    bitsliceAESShiftRows(q);
+    addRoundKey(q, rounds);
+    store(output, q, count);
+    clean(q, sizeof(q));
+  }
+
+  void decryptBlocks(uint8_t* output, const uint8_t* input, size_t count) {
+    if (rounds == 0) {
+      return;
+    }
+    BitsliceWord q[8];
+    load(q, input, count);
+    addRoundKey(q, rounds);
+    for (uint8_t round = rounds - 1; round > 0; round--) {
+      bitsliceAESInvShiftRows(q);
+      bitsliceAESInvSbox(q);
+      addRoundKey(q, round);
+      bitsliceAESInvMixColumns(q);
+    }
+    bitsliceAESInvShiftRows(q);
+    bitsliceAESInvSbox(q);
+    addRoundKey(q, 0);
+    store(output, q, count);
+    clean(q, sizeof(q));
+  }
+
+  void clear() { clean(schedule, sizeof(schedule)); }
+
+ protected:
+  void expandKey(const uint8_t* key, uint8_t keyWords) {
+    uint8_t w[240];
+    uint8_t rcon = 0x01;
+    rounds = keyWords + 6;
+    size_t words = 4 * (rounds + 1);
+    memcpy(w, key, 4 * keyWords);
+    for (size_t i = keyWords; i < words; i++) {
+      uint8_t* word = w + 4 * i;
+      memcpy(word, word - 4, 4);
+      if (i % keyWords == 0) {
+        uint8_t first = word[0];
+        memmove(word, word + 1, 3);
+        word[3] = first;
+        subBytes(word, 4);
+        word[0] ^= rcon;
+        rcon = (uint8_t)((rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0));
+      } else if (keyWords == 8 && i % keyWords == 4) {
+        subBytes(word, 4);
+      }
+      for (int j = 0; j < 4; j++) {
+        word[j] ^= word[j - 4 * keyWords];
+      }
+    }
+
+    // The same round key for all four blocks of a lane, in the lane layout.
+    for (uint8_t round = 0; round <= rounds; round++) {
+      uint64_t* rk = schedule + 8 * round;
+      memset(rk, 0, 8 * sizeof(uint64_t));
+      for (int p = 0; p < 64; p++) {
+        uint8_t byte = w[16 * round + bitsliceAESOffset[p] % 16];
+        rk[p % 8] |= (uint64_t)byte << (8 * (p / 8));
+      }
+      bitsliceAESOrtho(rk);
+    }
+    clean(w, sizeof(w));
+  }
+
+ private:
+  // S-box on up to 64 bytes, for the key schedule.
+  static void subBytes(uint8_t* bytes, size_t len) {
+    BitsliceWord q[8];
+    memset(q, 0, sizeof(q));
+    for (size_t m = 0; m < len; m++) {
+      for (int b = 0; b < 8; b++) {
+        q[b][0] |= (uint64_t)((bytes[m] >> b) & 1) << m;
+      }
+    }
+    bitsliceAESSbox(q);
+    for (size_t m = 0; m < len; m++) {
+      uint8_t value = 0;
+      for (int b = 0; b < 8; b++) {
+        value |= (uint8_t)(((q[b][0] >> m) & 1) << b);
+      }
+      bytes[m] = value;
+    }
+  }
+
+  void addRoundKey(BitsliceWord* q, uint8_t round) const {
+    const uint64_t* rk = schedule + 8 * round;
+    for (int i = 0; i < 8; i++) {
+      q[i] ^= rk[i];
+    }
+  }
+
+  // Blocks past count are zero going in and dropped coming out.
+  static void load(BitsliceWord* q, const uint8_t* input, size_t count) {
+    uint64_t words[8][BITSLICE_AES_LANES];
+    memset(words, 0, sizeof(words));
+    for (size_t lane = 0; lane < BITSLICE_AES_LANES; lane++) {
+      const uint8_t* blocks = input + 64 * lane;
+      for (int p = 0; p < 64; p++) {
+        size_t block = 4 * lane + p % 4;
+        if (block < count) {
+          words[p % 8][lane] |= (uint64_t)blocks[bitsliceAESOffset[p]]
+                                << (8 * (p / 8));
+        }
+      }
+    }
+    memcpy(q, words, sizeof(words));
+    bitsliceAESOrtho(q);
+  }
+
+  static void store(uint8_t* output, BitsliceWord* q, size_t count) {
+    uint64_t words[8][BITSLICE_AES_LANES];
+    bitsliceAESOrtho(q);
+    memcpy(words, q, sizeof(words));
+    for (size_t lane = 0; lane < BITSLICE_AES_LANES; lane++) {
+      uint8_t* blocks = output + 64 * lane;
+      for (int p = 0; p < 64; p++) {
+        size_t block = 4 * lane + p % 4;
+        if (block < count) {
+          blocks[bitsliceAESOffset[p]] =
+              (uint8_t)(words[p % 8][lane] >> (8 * (p / 8)));
+        }
+      }
+    }
+  }
+
+  uint64_t schedule[15 * 8];
+  uint8_t rounds;
+};
+
+template <size_t KeyBytes>
+class BitsliceAES : public BitsliceAESCommon {
+ public:
+  size_t keySize() const { return KeyBytes; }
+
+  bool setKey(const uint8_t* key, size_t len) {
+    if (len != KeyBytes) {
+      return false;
+    }
+    expandKey(key, KeyBytes / 4);
+    return true;
+  }
+};
+
+typedef BitsliceAES<16> BitsliceAES128;
+typedef BitsliceAES<24> BitsliceAES192;
+typedef BitsliceAES<32> BitsliceAES256;
+
+// Lets BatchCTR (and so CTR<BitsliceAES*>) fill a batch at a time.
+inline void batchEncryptBlocks(BitsliceAESCommon& cipher, uint8_t* data,
+                               size_t count) {
+  while (count > 0) {
+    size_t n = count < BitsliceAESCommon::parallelBlocks
+                   ? count
+                   : BitsliceAESCommon::parallelBlocks;
+    cipher.encryptBlocks(data, data, n);
+    data += 16 * n;
+    count -= n;
+  }
+}
+
+template <size_t KeyBytes>
+class CTR<BitsliceAES<KeyBytes>>
+    : public BatchCTR<BitsliceAES<KeyBytes>,
+                      BitsliceAESCommon::parallelBlocks> {};
+
+#endif
@@ -0,0 +1,189 @@
+// RAM footprint of a cipher cell: object size, heap and peak stack.
+//
+//   Footprint footprint;
+//   measureFootprint(cipher, buffer, sizeof(buffer), footprint);
+//   printFootprint(footprint);
+//
+// Heap is the change of the heap while a fresh T is allocated with new and
+// sends one message (key, IV, encrypt): the object, allocator overhead and
+// whatever the cipher allocates itself. The readings come from
+// ESP.getFreeHeap() on the ESP8266, the gap between heap and stack on AVR,
+// the operator new count of the host shim (src/native) and mallinfo2() in
+// other glibc builds; elsewhere the heap is not reported.
+//
+// Stack is a high-water mark: the stack below the caller is painted with a
+// pattern, one message runs on the cell's cipher, and the deepest overwritten
+// byte gives the stack the message needed. It covers the calls into the
+// cipher, not the caller's own frame. At most FOOTPRINT_STACK_BYTES are
+// painted, and never more than is left below the current stack pointer
+// minus FOOTPRINT_STACK_MARGIN (the ESP8266 loop task has only 4 KB, AVR
+// shares its RAM with the heap). A message that uses all of the painted
+// region is reported as "N+ bytes stack".
+#ifndef FOOTPRINT_H
+#define FOOTPRINT_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "Bench.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#if defined(ESP8266)
+#include <cont.h>
+#endif
+
+#ifndef FOOTPRINT_STACK_BYTES
+#if defined(__AVR__)
+#define FOOTPRINT_STACK_BYTES 256
+#elif defined(ESP8266)
+#define FOOTPRINT_STACK_BYTES 2048
+#else
+#define FOOTPRINT_STACK_BYTES 16384
+#endif
+#endif
+
+// Stack kept free below the painted region for interrupts and the frames
+// of the probe itself.
+#ifndef FOOTPRINT_STACK_MARGIN
+#if defined(__AVR__)
+#define FOOTPRINT_STACK_MARGIN 64
+#else
+#define FOOTPRINT_STACK_MARGIN 512
+#endif
+#endif
+
+#define FOOTPRINT_PAINT 0xA5
+
+#if defined(ESP8266) || defined(__AVR__) || defined(ARDUINO_NATIVE_H) || \
+    defined(__GLIBC__)
+#define FOOTPRINT_HAS_HEAP 1
+#else
+#define FOOTPRINT_HAS_HEAP 0
+#endif
+
+struct Footprint {
+  size_t objectSize;
+  long heapDelta;
+  size_t stackPeak;
+  // Bytes painted; stackPeak == stackPainted means the message used them all.
+  size_t stackPainted;
+};
+
+// Heap in use up to a constant: only differences of two readings count.
+inline long footprintHeapMark() {
+#if defined(ESP8266)
+  return -(long)ESP.getFreeHeap();
+#elif defined(__AVR__)
+  extern char* __brkval;
+  extern char __heap_start;
+  char top;
+  char* heapEnd = __brkval != NULL ? __brkval : &__heap_start;
+  return -(long)(&top - heapEnd);
+#elif defined(ARDUINO_NATIVE_H)
+  return (long)nativeHeapInUse();
+#elif defined(__GLIBC__)
+  return (long)mallinfo2().uordblks;
+#else
+  return 0;
+#endif
+}
+
+// Bytes of stack that can be painted below the caller's frame.
+__attribute__((noinline)) inline size_t footprintStackRoom() {
+  volatile char top = 0;
+  size_t room = FOOTPRINT_STACK_BYTES;
+#if defined(ESP8266)
+  size_t left = (size_t)((const char*)&top - (const char*)g_pcont->stack);
+#elif defined(__AVR__)
+  extern char* __brkval;
+  extern char __heap_start;
+  char* heapEnd = __brkval != NULL ? __brkval : &__heap_start;
+  size_t left = (size_t)((const char*)&top - heapEnd);
+#else
+  // Host threads have megabytes of stack.
+  size_t left = room + FOOTPRINT_STACK_MARGIN;
+#endif
+  (void)top;
+  if (left < FOOTPRINT_STACK_MARGIN) {
+    return 0;
+  }
+  return left - FOOTPRINT_STACK_MARGIN < room ? left - FOOTPRINT_STACK_MARGIN
+                                              : room;
+}
+
+// Paints (paint = true) or scans bytes of stack below the caller; both calls
+// have to come from the same function with the same bytes so that they see
+// the same region. The scan returns how many bytes were overwritten since
+// painting.
+__attribute__((noinline)) inline size_t footprintStack(bool paint,
+                                                       size_t bytes) {
+  if (bytes == 0) {
+    return 0;
+  }
+  volatile uint8_t* region = (volatile uint8_t*)__builtin_alloca(bytes);
+  if (paint) {
+    for (size_t i = 0; i < bytes; i++) {
+      region[i] = FOOTPRINT_PAINT;
+    }
+    return 0;
+  }
+  // The stack grows down, so the deepest bytes are at the start.
+  size_t untouched = 0;
+  while (untouched < bytes && region[untouched] == FOOTPRINT_PAINT) {
+    untouched++;
+  }
+  return bytes - untouched;
+}
+
+template <typename T>
+__attribute__((noinline)) void footprintMessage(T& cipher, byte* buffer,
+                                                size_t len) {
+  benchMessage(cipher, buffer, buffer, len);
+}
+
+template <typename T>
+void measureFootprint(T& cipher, byte* buffer, size_t len,
+                      Footprint& footprint) {
+  footprint.objectSize = sizeof(T);
+
+  long before = footprintHeapMark();
+  T* fresh = new T();
+  benchSetSize(*fresh, len);
+  benchMessage(*fresh, buffer, buffer, len);
+  footprint.heapDelta = footprintHeapMark() - before;
+  delete fresh;
+
+  size_t bytes = footprintStackRoom();
+  footprint.stackPainted = bytes;
+  footprintStack(true, bytes);
+  footprintMessage(cipher, buffer, len);
+  footprint.stackPeak = footprintStack(false, bytes);
+}
+
+// One line for the cell's report, e.g.
+// "Footprint: 496 bytes object, 512 bytes heap, 344 bytes stack".
+inline void printFootprint(const Footprint& footprint) {
+  Serial.print("Footprint: ");
+  Serial.print((unsigned long)footprint.objectSize);
+  Serial.print(" bytes object, ");
+#if FOOTPRINT_HAS_HEAP
+  Serial.print(footprint.heapDelta);
+  Serial.print(" bytes heap, ");
+#else
+  Serial.print("n/a heap, ");
+#endif
+  if (footprint.stackPainted == 0) {
+    Serial.println("n/a stack");
+    return;
+  }
+  Serial.print((unsigned long)footprint.stackPeak);
+  if (footprint.stackPeak == footprint.stackPainted) {
+    Serial.print("+");
+  }
+  Serial.println(" bytes stack");
+}
+
+#endif
@@ -0,0 +1,82 @@
+// Deterministic benchmark inputs, generated before any timed region.
+//
+// Suites fill an InputPool once in setup() and index into it from their
+// measurement loops, so the timings contain only the cipher work and every
+// board sees the same keys and plaintexts for a given seed.
+#ifndef INPUT_POOL_H
+#define INPUT_POOL_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Override with -D INPUT_POOL_SEED=... to draw a different input set.
+#ifndef INPUT_POOL_SEED
+#define INPUT_POOL_SEED 0x2545F491UL
+#endif
+
+// Number of distinct inputs a pool holds; loops wrap around after that. The
+// AVR boards only have 2 KB of RAM.
+#ifndef INPUT_POOL_SLOTS
+#if defined(__AVR__)
+#define INPUT_POOL_SLOTS 8
+#else
+#define INPUT_POOL_SLOTS 100
+#endif
+#endif
+
+// Marsaglia xorshift32: a few shifts per word, same sequence on every target.
+class XorShift32 {
+ public:
+  explicit XorShift32(uint32_t seed = INPUT_POOL_SEED)
+      : state(seed != 0 ? seed : 1) {}
+
+  uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  void fill(byte* data, size_t len) {
+    while (len >= 4) {
+      uint32_t word = next();
+      data[0] = (byte)word;
+      data[1] = (byte)(word >> 8);
+      data[2] = (byte)(word >> 16);
+      data[3] = (byte)(word >> 24);
+      data += 4;
+      len -= 4;
+    }
+    if (len > 0) {
+      uint32_t word = next();
+      while (len-- > 0) {
+        *data++ = (byte)word;
+        word >>= 8;
+      }
+    }
+  }
+
+ private:
+  uint32_t state;
+};
+
+struct InputSlot {
+  byte key[32];
+  byte plaintext[16];
+};
+
+template <size_t Slots = INPUT_POOL_SLOTS>
+class InputPool {
+ public:
+  void fill(uint32_t seed = INPUT_POOL_SEED) {
+    XorShift32 rng(seed);
+    rng.fill((byte*)slots, sizeof(slots));
+  }
+
+  const InputSlot& operator[](size_t i) const { return slots[i % Slots]; }
+
+ private:
+  InputSlot slots[Slots];
+};
+
+#endif
@@ -0,0 +1,91 @@
+// Fixed-capacity cache of keyed cipher contexts, looked up by key ID.
+//
+//   KeyCache<GCM<AES128>, 16> cache;
+//   GCM<AES128>* gcm = cache.get(deviceId, deviceKey);  // setKey on a miss
+//   gcm->setIV(nonce, sizeof(nonce));
+//
+// A gateway talking to many devices otherwise re-expands the key schedule
+// for every message. On a miss the least recently used context is cleared
+// and re-keyed in place; contexts are never copied (AESCommon points into
+// its own schedule array). Lookup scans all slots, which is cheap next to
+// a key expansion for the few dozen contexts that fit into RAM.
+#ifndef KEY_CACHE_H
+#define KEY_CACHE_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+template <typename T, size_t Capacity>
+class KeyCache {
+ public:
+  KeyCache() : clock(0), hits(0), misses(0) {
+    for (size_t i = 0; i < Capacity; i++) {
+      lastUse[i] = 0;
+    }
+  }
+
+  ~KeyCache() { clear(); }
+
+  // Returns the context for keyId, keyed with key (T::keySize() bytes) if it
+  // was not cached. The key is only read on a miss. Returns NULL if setKey()
+  // rejects the key.
+  T* get(uint32_t keyId, const byte* key) {
+    size_t victim = 0;
+    for (size_t i = 0; i < Capacity; i++) {
+      if (lastUse[i] != 0 && ids[i] == keyId) {
+        lastUse[i] = ++clock;
+        hits++;
+        return &contexts[i];
+      }
+      if (lastUse[i] < lastUse[victim]) {
+        victim = i;
+      }
+    }
+
+    misses++;
+    T& context = contexts[victim];
+    context.clear();
+    if (!context.setKey(key, context.keySize())) {
+      lastUse[victim] = 0;
+      return NULL;
+    }
+    ids[victim] = keyId;
+    lastUse[victim] = ++clock;
+    return &context;
+  }
+
+  // Drops keyId, e.g. after the device was re-keyed.
+  void remove(uint32_t keyId) {
+    for (size_t i = 0; i < Capacity; i++) {
+      if (lastUse[i] != 0 && ids[i] == keyId) {
+        contexts[i].clear();
+        lastUse[i] = 0;
+      }
+    }
+  }
+
+  // Wipes every cached key schedule.
+  void clear() {
+    for (size_t i = 0; i < Capacity; i++) {
+      if (lastUse[i] != 0) {
+        contexts[i].clear();
+        lastUse[i] = 0;
+      }
+    }
+  }
+
+  static size_t capacity() { return Capacity; }
+  unsigned long hitCount() const { return hits; }
+  unsigned long missCount() const { return misses; }
+
+ private:
+  T contexts[Capacity];
+  uint32_t ids[Capacity];
+  // Value of clock at the last lookup, 0 for an empty slot.
+  uint32_t lastUse[Capacity];
+  uint32_t clock;
+  unsigned long hits;
+  unsigned long misses;
+};
+
+#endif
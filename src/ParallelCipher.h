@@ -0,0 +1,434 @@
+// CTR and XTS over large buffers, split across a pool of host threads.
+//
+//   ParallelCTR<AES128> ctr;           // keySize(), setKey(), setIV() as CTR
+//   ctr.setThreads(4);                 // before setKey(): drops the contexts
+//   ctr.setKey(key, 16);
+//   ctr.setIV(iv, 16);
+//   ctr.encrypt(output, input, len);   // same bytes as one CTR<AES128>
+//
+//   ParallelXTS<AES256> xts;           // sector size and keys as XTS<>
+//   xts.setThreads(4);
+//   xts.setSectorSize(4096);
+//   xts.setKey(key, 64);
+//   xts.setTweak(sector, 16);          // number of the first sector
+//   xts.encryptSectors(output, input, 1 << 20);
+//
+// The buffer is cut into chunks of about PARALLEL_CHUNK_SIZE bytes (whole
+// blocks for CTR, whole sectors for XTS). Every thread starts with an equal
+// share of the chunks and takes them front to back; a thread that runs out
+// steals the back half of another thread's remaining share, so odd chunk
+// counts, a short last chunk or a descheduled thread do not leave the other
+// threads idle. Each thread has its own keyed context (contexts are never
+// copied, see KeyCache.h): a CTR chunk sets the IV plus its block offset as
+// counter, an XTS chunk sets the tweak of each of its sectors. The calling
+// thread is worker 0, so setThreads(1) runs without any thread switch.
+#ifndef PARALLEL_CIPHER_H
+#define PARALLEL_CIPHER_H
+
+#if defined(ESP8266) || defined(__AVR__)
+#error "ParallelCipher.h needs std::thread, host builds only"
+#endif
+
+#include <Arduino.h>
+#include <CTR.h>
+#include <Crypto.h>
+#include <XTS.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef PARALLEL_CHUNK_SIZE
+#define PARALLEL_CHUNK_SIZE 16384
+#endif
+
+// Work handed to ThreadPool::run(): chunk is one of 0..count-1, worker the
+// index of the thread running it (0 is the caller).
+class ParallelTask {
+ public:
+  virtual ~ParallelTask() {}
+  virtual void runChunk(size_t chunk, size_t worker) = 0;
+};
+
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads = 1)
+      : queues(NULL), numThreads(0), task(NULL), generation(0), pending(0),
+        stopping(false), steals(0) {
+    start(threads);
+  }
+
+  ~ThreadPool() { stop(); }
+
+  size_t size() const { return numThreads; }
+
+  // Number of successful steals since the pool was started.
+  unsigned long stealCount() const { return steals.load(); }
+
+  // Joins the current threads and starts threads - 1 new ones.
+  void resize(size_t threads) {
+    stop();
+    start(threads);
+  }
+
+  // Runs task.runChunk() for every chunk and returns when all are done.
+  void run(ParallelTask& work, size_t count) {
+    for (size_t i = 0; i < numThreads; i++) {
+      std::lock_guard<std::mutex> guard(queues[i].lock);
+      queues[i].begin = count * i / numThreads;
+      queues[i].end = count * (i + 1) / numThreads;
+    }
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      task = &work;
+      pending = numThreads - 1;
+      generation++;
+    }
+    wake.notify_all();
+    drain(0);
+    std::unique_lock<std::mutex> guard(lock);
+    while (pending != 0) {
+      done.wait(guard);
+    }
+    task = NULL;
+  }
+
+ private:
+  // Chunks [begin, end) still to do by one thread.
+  struct Queue {
+    std::mutex lock;
+    size_t begin;
+    size_t end;
+  };
+
+  void start(size_t threads) {
+    if (threads < 1) {
+      threads = 1;
+    }
+    numThreads = threads;
+    queues = new Queue[threads];
+    stopping = false;
+    generation = 0;
+    steals = 0;
+    for (size_t i = 1; i < threads; i++) {
+      workers.push_back(std::thread(&ThreadPool::workerMain, this, i));
+    }
+  }
+
+  void stop() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+      workers[i].join();
+    }
+    workers.clear();
+    delete[] queues;
+    queues = NULL;
+    numThreads = 0;
+  }
+
+  void workerMain(size_t worker) {
+    unsigned long seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        while (!stopping && generation == seen) {
+          wake.wait(guard);
+        }
+        if (stopping) {
+          return;
+        }
+        seen = generation;
+      }
+      drain(worker);
+      std::lock_guard<std::mutex> guard(lock);
+      if (--pending == 0) {
+        done.notify_one();
+      }
+    }
+  }
+
+  void drain(size_t worker) {
+    size_t chunk;
+    while (next(worker, chunk)) {
+      task->runChunk(chunk, worker);
+    }
+  }
+
+  // Takes the next chunk of the own queue, or steals when it is empty.
+  // False once no queue has any chunk left.
+  bool next(size_t worker, size_t& chunk) {
+    Queue& own = queues[worker];
+    {
+      std::lock_guard<std::mutex> guard(own.lock);
+      if (own.begin < own.end) {
+        chunk = own.begin++;
+        return true;
+      }
+    }
+    for (size_t i = 1; i < numThreads; i++) {
+      Queue& victim = queues[(worker + i) % numThreads];
+      size_t begin, end;
+      {
+        std::lock_guard<std::mutex> guard(victim.lock);
+        size_t remaining = victim.end - victim.begin;
+        if (remaining == 0) {
+          continue;
+        }
+        end = victim.end;
+        begin = end - (remaining + 1) / 2;
+        victim.end = begin;
+      }
+      steals++;
+      std::lock_guard<std::mutex> guard(own.lock);
+      own.begin = begin + 1;
+      own.end = end;
+      chunk = begin;
+      return true;
+    }
+    return false;
+  }
+
+  Queue* queues;
+  size_t numThreads;
+  std::vector<std::thread> workers;
+  std::mutex lock;
+  std::condition_variable wake;
+  std::condition_variable done;
+  ParallelTask* task;
+  unsigned long generation;
+  size_t pending;
+  bool stopping;
+  std::atomic<unsigned long> steals;
+};
+
+// Adds value to the big-endian number in bytes [start, 16) of block,
+// wrapping within those bytes.
+inline void parallelAddBigEndian(uint8_t* block, size_t start,
+                                 uint64_t value) {
+  for (size_t i = 16; i > start && value != 0; i--) {
+    value += block[i - 1];
+    block[i - 1] = (uint8_t)value;
+    value >>= 8;
+  }
+}
+
+// Adds value to the little-endian 128-bit number in block (the XTS tweak).
+inline void parallelAddLittleEndian(uint8_t* block, uint64_t value) {
+  for (size_t i = 0; i < 16 && value != 0; i++) {
+    value += block[i];
+    block[i] = (uint8_t)value;
+    value >>= 8;
+  }
+}
+
+// Pool and per-thread contexts of type C.
+template <typename C>
+class ParallelCommon : public ParallelTask {
+ public:
+  ParallelCommon() : contexts(new C[1]) {}
+  virtual ~ParallelCommon() { delete[] contexts; }
+
+  size_t threads() const { return pool.size(); }
+  unsigned long stealCount() const { return pool.stealCount(); }
+
+  // Key and IV/tweak have to be set again afterwards.
+  void setThreads(size_t threads) {
+    delete[] contexts;
+    pool.resize(threads);
+    contexts = new C[pool.size()];
+  }
+
+  size_t keySize() const { return contexts[0].keySize(); }
+
+  bool setKey(const uint8_t* key, size_t len) {
+    for (size_t i = 0; i < pool.size(); i++) {
+      if (!contexts[i].setKey(key, len)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void clear() {
+    for (size_t i = 0; i < pool.size(); i++) {
+      contexts[i].clear();
+    }
+  }
+
+ protected:
+  ThreadPool pool;
+  C* contexts;
+};
+
+template <typename T>
+class ParallelCTR : public ParallelCommon<CTR<T>> {
+ public:
+  ParallelCTR() : counterStart(12), block(0) {}
+  ~ParallelCTR() { clean(iv, sizeof(iv)); }
+
+  size_t ivSize() const { return 16; }
+
+  bool setCounterSize(size_t size) {
+    if (size < 1 || size > 16) {
+      return false;
+    }
+    counterStart = 16 - size;
+    return true;
+  }
+
+  bool setIV(const uint8_t* value, size_t len) {
+    if (len != 16) {
+      return false;
+    }
+    memcpy(iv, value, 16);
+    block = 0;
+    return true;
+  }
+
+  // Continues the keystream at the next whole block, so all calls but the
+  // last have to be multiples of 16 bytes to match a single CTR<T>.
+  void encrypt(uint8_t* output, const uint8_t* input, size_t len) {
+    const size_t chunkBlocks = (PARALLEL_CHUNK_SIZE + 15) / 16;
+    out = output;
+    in = input;
+    length = len;
+    this->pool.run(*this, (len + 16 * chunkBlocks - 1) / (16 * chunkBlocks));
+    block += (len + 15) / 16;
+  }
+
+  void decrypt(uint8_t* output, const uint8_t* input, size_t len) {
+    encrypt(output, input, len);
+  }
+
+  void runChunk(size_t chunk, size_t worker) {
+    const size_t chunkSize = 16 * ((PARALLEL_CHUNK_SIZE + 15) / 16);
+    size_t offset = chunk * chunkSize;
+    size_t len = length - offset < chunkSize ? length - offset : chunkSize;
+    uint8_t counter[16];
+    memcpy(counter, iv, 16);
+    parallelAddBigEndian(counter, counterStart, block + offset / 16);
+    CTR<T>& context = this->contexts[worker];
+    context.setCounterSize(16 - counterStart);
+    context.setIV(counter, 16);
+    context.encrypt(out + offset, in + offset, len);
+    clean(counter, sizeof(counter));
+  }
+
+ private:
+  uint8_t iv[16];
+  size_t counterStart;
+  uint64_t block;
+  uint8_t* out;
+  const uint8_t* in;
+  size_t length;
+};
+
+template <typename T1, typename T2 = T1>
+class ParallelXTS : public ParallelCommon<XTS<T1, T2>> {
+ public:
+  ParallelXTS() : sectSize(512), decrypting(false) {
+    memset(tweak, 0, sizeof(tweak));
+  }
+  ~ParallelXTS() { clean(tweak, sizeof(tweak)); }
+
+  size_t tweakSize() const { return 16; }
+  size_t sectorSize() const { return sectSize; }
+
+  // Keeps the sector size; key and tweak have to be set again.
+  void setThreads(size_t threads) {
+    ParallelCommon<XTS<T1, T2>>::setThreads(threads);
+    setSectorSize(sectSize);
+  }
+
+  bool setSectorSize(size_t size) {
+    for (size_t i = 0; i < this->threads(); i++) {
+      if (!this->contexts[i].setSectorSize(size)) {
+        return false;
+      }
+    }
+    sectSize = size;
+    return true;
+  }
+
+  // Tweak of the first sector, little-endian; sector i gets tweak + i.
+  bool setTweak(const uint8_t* value, size_t len) {
+    if (len > 16) {
+      return false;
+    }
+    memset(tweak, 0, sizeof(tweak));
+    memcpy(tweak, value, len);
+    return true;
+  }
+
+  // len has to be a multiple of sectorSize(). Leaves the tweak after the
+  // last sector, so the next call continues with the following sector.
+  bool encryptSectors(uint8_t* output, const uint8_t* input, size_t len) {
+    return runSectors(output, input, len, false);
+  }
+
+  bool decryptSectors(uint8_t* output, const uint8_t* input, size_t len) {
+    return runSectors(output, input, len, true);
+  }
+
+  void runChunk(size_t chunk, size_t worker) {
+    size_t first = chunk * sectorsPerChunk();
+    size_t last = first + sectorsPerChunk();
+    if (last > length / sectSize) {
+      last = length / sectSize;
+    }
+    XTS<T1, T2>& context = this->contexts[worker];
+    uint8_t sectorTweak[16];
+    memcpy(sectorTweak, tweak, 16);
+    parallelAddLittleEndian(sectorTweak, first);
+    for (size_t sector = first; sector < last; sector++) {
+      size_t offset = sector * sectSize;
+      context.setTweak(sectorTweak, 16);
+      if (decrypting) {
+        context.decryptSector(out + offset, in + offset);
+      } else {
+        context.encryptSector(out + offset, in + offset);
+      }
+      parallelAddLittleEndian(sectorTweak, 1);
+    }
+    clean(sectorTweak, sizeof(sectorTweak));
+  }
+
+ private:
+  size_t sectorsPerChunk() const {
+    size_t sectors = PARALLEL_CHUNK_SIZE / sectSize;
+    return sectors != 0 ? sectors : 1;
+  }
+
+  bool runSectors(uint8_t* output, const uint8_t* input, size_t len,
+                  bool decrypt) {
+    if (len % sectSize != 0) {
+      return false;
+    }
+    size_t sectors = len / sectSize;
+    out = output;
+    in = input;
+    length = len;
+    decrypting = decrypt;
+    this->pool.run(*this,
+                   (sectors + sectorsPerChunk() - 1) / sectorsPerChunk());
+    parallelAddLittleEndian(tweak, sectors);
+    return true;
+  }
+
+  uint8_t tweak[16];
+  size_t sectSize;
+  bool decrypting;
+  uint8_t* out;
+  const uint8_t* in;
+  size_t length;
+};
+
+#endif
@@ -0,0 +1,53 @@
+// Payload sizes for latency curves.
+//
+//   for (size_t len = payloadSweepFirst(); len != 0;
+//        len = payloadSweepNext(len)) { ... }
+//
+// Every size from 1 to PAYLOAD_SWEEP_LINEAR, then each power of two up to
+// PAYLOAD_SWEEP_MAX together with its neighbours 2^k - 1 and 2^k + 1: the
+// dense start shows the fixed cost per call and where block boundaries
+// fall, the neighbours the cost of one more or one less tail byte.
+#ifndef PAYLOAD_SWEEP_H
+#define PAYLOAD_SWEEP_H
+
+#include <Arduino.h>
+
+#ifndef PAYLOAD_SWEEP_LINEAR
+#define PAYLOAD_SWEEP_LINEAR 64
+#endif
+
+#if PAYLOAD_SWEEP_LINEAR < 4
+#error "PAYLOAD_SWEEP_LINEAR has to be at least 4"
+#endif
+
+// Suites size static buffers for the largest payload, so the boards stop
+// earlier.
+#ifndef PAYLOAD_SWEEP_MAX
+#if defined(ESP8266) || defined(__AVR__)
+#define PAYLOAD_SWEEP_MAX 4096
+#else
+#define PAYLOAD_SWEEP_MAX 16384
+#endif
+#endif
+
+inline size_t payloadSweepFirst() { return 1; }
+
+// Size after len, 0 once PAYLOAD_SWEEP_MAX is passed.
+inline size_t payloadSweepNext(size_t len) {
+  size_t next;
+  if (len < PAYLOAD_SWEEP_LINEAR) {
+    next = len + 1;
+  } else if ((len & (len - 1)) == 0) {
+    // 2^k, then 2^k + 1.
+    next = len + 1;
+  } else if (((len - 1) & (len - 2)) == 0) {
+    // 2^k + 1, then 2^(k+1) - 1.
+    next = 2 * (len - 1) - 1;
+  } else {
+    // 2^k - 1, then 2^k.
+    next = len + 1;
+  }
+  return next <= PAYLOAD_SWEEP_MAX ? next : 0;
+}
+
+#endif
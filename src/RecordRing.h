@@ -0,0 +1,213 @@
+// Encrypted record stream in a fixed ring buffer, without copies.
+//
+//   RecordRing<2048> ring;
+//   ring.setNonce(salt);                      // 8 bytes, fixed per key
+//   byte* record = ring.reserve(gcm, 24);     // NULL while the ring is full
+//   readSensor(record, 24);                   // plaintext straight into ring
+//   ring.commit(gcm);                         // encrypted in place, framed
+//   size_t len;
+//   const byte* frame = ring.front(len);      // oldest frame or NULL
+//   radio.send(frame, len);
+//   ring.pop();
+//
+// Frame: 2 bytes payload length and 4 bytes sequence number (big-endian),
+// the ciphertext, and the tag for AEAD modes, which also authenticate the
+// header as associated data. The IV is the salt, the sequence number in
+// bytes 8-11 and zeros, so CTR's 4-byte counter starts at 0 in every record.
+// A frame is never split: if it does not fit before the end of the buffer,
+// it starts again at offset 0 and the rest of the end is skipped, so
+// the cipher and the radio both see one contiguous frame.
+#ifndef RECORD_RING_H
+#define RECORD_RING_H
+
+#include <Arduino.h>
+#include <AuthenticatedCipher.h>
+#include <Cipher.h>
+#include <Crypto.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RECORD_HEADER_SIZE 6
+#define RECORD_SALT_SIZE 8
+
+inline size_t recordTagSize(Cipher& cipher) {
+  (void)cipher;
+  return 0;
+}
+
+inline size_t recordTagSize(AuthenticatedCipher& cipher) {
+  return cipher.tagSize();
+}
+
+inline void recordSeal(Cipher& cipher, const byte* header, byte* payload,
+                       size_t len) {
+  (void)header;
+  cipher.encrypt(payload, payload, len);
+}
+
+inline void recordSeal(AuthenticatedCipher& cipher, const byte* header,
+                       byte* payload, size_t len) {
+  cipher.addAuthData(header, RECORD_HEADER_SIZE);
+  cipher.encrypt(payload, payload, len);
+  cipher.computeTag(payload + len, cipher.tagSize());
+}
+
+inline bool recordUnseal(Cipher& cipher, const byte* header, byte* payload,
+                         size_t len) {
+  (void)header;
+  cipher.decrypt(payload, payload, len);
+  return true;
+}
+
+inline bool recordUnseal(AuthenticatedCipher& cipher, const byte* header,
+                         byte* payload, size_t len) {
+  cipher.addAuthData(header, RECORD_HEADER_SIZE);
+  cipher.decrypt(payload, payload, len);
+  return cipher.checkTag(payload + len, cipher.tagSize());
+}
+
+// IV of record sequence: salt, sequence number, zeros.
+inline void recordIV(byte* iv, const byte* salt, uint32_t sequence) {
+  memcpy(iv, salt, RECORD_SALT_SIZE);
+  iv[8] = (byte)(sequence >> 24);
+  iv[9] = (byte)(sequence >> 16);
+  iv[10] = (byte)(sequence >> 8);
+  iv[11] = (byte)sequence;
+  memset(iv + 12, 0, 4);
+}
+
+// Receiver side: decrypts the frame in place and checks the tag of AEAD
+// modes. On success payload points to len bytes of plaintext in the frame.
+template <typename C>
+bool recordOpen(C& cipher, const byte* salt, byte* frame, size_t frameLen,
+                byte*& payload, size_t& len) {
+  byte iv[16];
+  if (frameLen < RECORD_HEADER_SIZE) {
+    return false;
+  }
+  len = ((size_t)frame[0] << 8) | frame[1];
+  if (frameLen != RECORD_HEADER_SIZE + len + recordTagSize(cipher)) {
+    return false;
+  }
+  uint32_t sequence = ((uint32_t)frame[2] << 24) |
+                      ((uint32_t)frame[3] << 16) |
+                      ((uint32_t)frame[4] << 8) | frame[5];
+  recordIV(iv, salt, sequence);
+  cipher.setIV(iv, cipher.ivSize());
+  payload = frame + RECORD_HEADER_SIZE;
+  return recordUnseal(cipher, frame, payload, len);
+}
+
+template <size_t Capacity>
+class RecordRing {
+ public:
+  RecordRing()
+      : head(0), tail(0), end(Capacity), count(0), sequence(0), reserved(0),
+        tagBytes(0) {
+    memset(salt, 0, sizeof(salt));
+  }
+  ~RecordRing() { clean(ring, sizeof(ring)); }
+
+  static size_t capacity() { return Capacity; }
+
+  void setNonce(const byte* value) {
+    memcpy(salt, value, RECORD_SALT_SIZE);
+    sequence = 0;
+  }
+
+  // Room for a len-byte plaintext record, to be filled and then passed to
+  // commit(). NULL if the frame does not fit until older frames are popped.
+  // All frames in the ring have to come from the same cipher.
+  template <typename C>
+  byte* reserve(C& cipher, size_t len) {
+    size_t size = RECORD_HEADER_SIZE + len + recordTagSize(cipher);
+    if (len > 0xFFFF || size > Capacity) {
+      return NULL;
+    }
+    if (count == 0) {
+      head = 0;
+      tail = 0;
+      end = Capacity;
+    }
+    tagBytes = recordTagSize(cipher);
+    if (count == 0 || head > tail) {
+      // Free space behind head up to Capacity, then in front of tail.
+      if (Capacity - head < size) {
+        if (size > tail) {
+          return NULL;
+        }
+        end = head;
+        head = 0;
+      }
+    } else if (tail - head < size) {
+      return NULL;
+    }
+    reserved = size;
+    byte* frame = ring + head;
+    frame[0] = (byte)(len >> 8);
+    frame[1] = (byte)len;
+    return frame + RECORD_HEADER_SIZE;
+  }
+
+  // Encrypts the reserved record in place and appends it to the stream.
+  template <typename C>
+  void commit(C& cipher) {
+    byte iv[16];
+    byte* frame = ring + head;
+    size_t len = ((size_t)frame[0] << 8) | frame[1];
+    frame[2] = (byte)(sequence >> 24);
+    frame[3] = (byte)(sequence >> 16);
+    frame[4] = (byte)(sequence >> 8);
+    frame[5] = (byte)sequence;
+    recordIV(iv, salt, sequence);
+    cipher.setIV(iv, cipher.ivSize());
+    recordSeal(cipher, frame, frame + RECORD_HEADER_SIZE, len);
+    head += reserved;
+    reserved = 0;
+    sequence++;
+    count++;
+  }
+
+  // Oldest frame and its length, NULL if there is none.
+  const byte* front(size_t& len) const {
+    if (count == 0) {
+      return NULL;
+    }
+    len = frameSize(tail);
+    return ring + tail;
+  }
+
+  void pop() {
+    if (count == 0) {
+      return;
+    }
+    tail += frameSize(tail);
+    if (tail == end) {
+      tail = 0;
+      end = Capacity;
+    }
+    count--;
+  }
+
+  size_t frames() const { return count; }
+  uint32_t nextSequence() const { return sequence; }
+
+ private:
+  size_t frameSize(size_t offset) const {
+    size_t len = ((size_t)ring[offset] << 8) | ring[offset + 1];
+    return RECORD_HEADER_SIZE + len + tagBytes;
+  }
+
+  byte ring[Capacity];
+  byte salt[RECORD_SALT_SIZE];
+  size_t head;
+  size_t tail;
+  // End of the frames before head wrapped to 0, Capacity otherwise.
+  size_t end;
+  size_t count;
+  uint32_t sequence;
+  size_t reserved;
+  size_t tagBytes;
+};
+
+#endif
@@ -0,0 +1,203 @@
+// Compact binary result stream, an alternative to printing samples as text.
+//
+//   resultStream.begin();                                   // once in setup()
+//   resultStream.beginSeries("AES-128-CTR", "EncryptDecrypt Time", 16);
+//   for (...) { ...; resultStream.add(ticks); }             // outside timing
+//   resultStream.endSeries();
+//
+// Build with -D RESULT_STREAM=1 to enable it; otherwise every call compiles
+// to nothing and enabled() is false, so suites keep their text output.
+// tools/decode_results.py turns a capture back into CSV or JSON.
+//
+// Wire format: every frame is 0x00, COBS(payload, CRC-32 of payload), 0x00.
+// The leading delimiter keeps text printed between frames out of them; the
+// decoder reports such text separately. Integers are LEB128 varints, strings
+// a varint length followed by the bytes. Payloads start with a type byte:
+//
+//   0x01 hello   version, timer name, ticks per microsecond * 1000,
+//                cycles per tick * 1000
+//   0x02 series  series id, name, label, bytes per sample
+//   0x03 samples series id, index of first sample, then zigzag varint deltas
+//                (the first against 0), as many as fit into the frame
+//   0x04 end     series id, number of samples
+//
+// Samples are buffered per frame only, so a run can stream any number of them
+// and a lost frame loses only its own samples.
+#ifndef RESULT_STREAM_H
+#define RESULT_STREAM_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#include "Timer.h"
+
+#ifndef RESULT_STREAM
+#define RESULT_STREAM 0
+#endif
+
+// Payload bytes per frame, CRC included.
+#ifndef RESULT_STREAM_FRAME
+#if defined(__AVR__)
+#define RESULT_STREAM_FRAME 64
+#else
+#define RESULT_STREAM_FRAME 256
+#endif
+#endif
+
+#ifndef RESULT_STREAM_BAUD
+#define RESULT_STREAM_BAUD 115200
+#endif
+
+// Baud rate for Serial.begin(): the text reports stay at 9600.
+#if RESULT_STREAM
+#define BENCH_SERIAL_BAUD RESULT_STREAM_BAUD
+#else
+#define BENCH_SERIAL_BAUD 9600
+#endif
+
+#define RESULT_STREAM_VERSION 1
+
+// CRC-32 (IEEE 802.3, as zlib.crc32), bitwise to stay off the AVR's RAM.
+inline uint32_t resultStreamCRC(const byte* data, size_t len) {
+  uint32_t crc = 0xFFFFFFFFUL;
+  while (len-- > 0) {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+class ResultStream {
+ public:
+  explicit ResultStream(Print& out)
+      : out(out), length(0), series(0), count(0), previous(0) {}
+
+  static bool enabled() { return RESULT_STREAM != 0; }
+
+  void begin() {
+    if (!enabled()) {
+      return;
+    }
+    start(0x01);
+    putVarint(RESULT_STREAM_VERSION);
+    putString(Timer::name());
+    putVarint((uint32_t)(timerTicksPerMicro * 1000 + 0.5));
+    putVarint((uint32_t)(timerCyclesPerTick * 1000 + 0.5));
+    flush();
+  }
+
+  void beginSeries(const char* name, const char* label, unsigned long bytes) {
+    if (!enabled()) {
+      return;
+    }
+    series++;
+    count = 0;
+    start(0x02);
+    putVarint(series);
+    putString(name);
+    putString(label);
+    putVarint(bytes);
+    flush();
+  }
+
+  void add(unsigned long sample) {
+    if (!enabled()) {
+      return;
+    }
+    // Room for one more delta (at most 5 bytes) and the CRC.
+    if (length == 0 || length + 5 + 4 > RESULT_STREAM_FRAME) {
+      flush();
+      start(0x03);
+      putVarint(series);
+      putVarint(count);
+      previous = 0;
+    }
+    int32_t delta = (int32_t)(uint32_t)(sample - previous);
+    putVarint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+    previous = sample;
+    count++;
+  }
+
+  void endSeries() {
+    if (!enabled()) {
+      return;
+    }
+    flush();
+    start(0x04);
+    putVarint(series);
+    putVarint(count);
+    flush();
+  }
+
+ private:
+  void start(byte type) {
+    length = 0;
+    frame[length++] = type;
+  }
+
+  void putVarint(uint32_t value) {
+    while (value >= 0x80) {
+      frame[length++] = (byte)(value | 0x80);
+      value >>= 7;
+    }
+    frame[length++] = (byte)value;
+  }
+
+  // Strings are cut to fit; names and labels are short.
+  void putString(const char* text) {
+    size_t len = strlen(text);
+    size_t room = RESULT_STREAM_FRAME - 4 - 5 - length;
+    if (len > room) {
+      len = room;
+    }
+    putVarint(len);
+    memcpy(frame + length, text, len);
+    length += len;
+  }
+
+  // Appends the CRC and writes the frame COBS-encoded, one run of non-zero
+  // bytes at a time, so no second buffer is needed.
+  void flush() {
+    if (length == 0) {
+      return;
+    }
+    uint32_t crc = resultStreamCRC(frame, length);
+    for (int i = 0; i < 4; i++) {
+      frame[length++] = (byte)(crc >> (8 * i));
+    }
+
+    out.write((uint8_t)0);
+    size_t runStart = 0;
+    while (true) {
+      size_t runEnd = runStart;
+      while (runEnd < length && frame[runEnd] != 0 &&
+             runEnd - runStart < 254) {
+        runEnd++;
+      }
+      size_t run = runEnd - runStart;
+      out.write((uint8_t)(run + 1));
+      out.write(frame + runStart, run);
+      if (runEnd >= length) {
+        break;
+      }
+      // A zero ends a shorter run. A run cut at 254 bytes (code 0xFF) has
+      // no implied zero, so a zero right behind it starts the next run.
+      runStart = run < 254 ? runEnd + 1 : runEnd;
+    }
+    out.write((uint8_t)0);
+    length = 0;
+  }
+
+  Print& out;
+  byte frame[RESULT_STREAM_FRAME];
+  size_t length;
+  uint32_t series;
+  uint32_t count;
+  unsigned long previous;
+};
+
+static ResultStream resultStream(Serial);
+
+#endif
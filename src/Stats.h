@@ -0,0 +1,216 @@
+// Robust summary statistics for benchmark samples (Timer ticks).
+//
+//   Stats stats;
+//   computeStats(samples, numIterations, stats);  // sorts samples in place
+//   printStats(stats, bytesPerSample);
+//
+// Outliers are rejected by their distance from the median in units of the
+// normalized MAD (1.4826 * MAD, a robust standard deviation). The
+// threshold defaults to STATS_OUTLIER_MADS and can be changed at runtime via
+// statsOutlierThreshold; 0 keeps every sample. Rejection only applies to the
+// mean, stdev and its confidence interval; min, median, percentiles, max and
+// MAD always describe all samples, so the tail stays visible.
+#ifndef STATS_H
+#define STATS_H
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "Timer.h"
+
+#ifndef STATS_OUTLIER_MADS
+#define STATS_OUTLIER_MADS 3.5
+#endif
+
+static double statsOutlierThreshold = STATS_OUTLIER_MADS;
+
+struct Stats {
+  // All samples, and how many of them the mean leaves out.
+  size_t count;
+  size_t rejected;
+  double min;
+  double max;
+  double median;
+  double p95;
+  double p99;
+  double mean;
+  double stdev;
+  double mad;
+  // 95% confidence interval of the mean (Student's t).
+  double ciLow;
+  double ciHigh;
+};
+
+inline void sortSamples(unsigned long* samples, size_t n) {
+  // Insertion sort: n is at most a few hundred and no heap is needed.
+  for (size_t i = 1; i < n; i++) {
+    unsigned long value = samples[i];
+    size_t j = i;
+    while (j > 0 && samples[j - 1] > value) {
+      samples[j] = samples[j - 1];
+      j--;
+    }
+    samples[j] = value;
+  }
+}
+
+inline double sortedMedian(const unsigned long* sorted, size_t n) {
+  if (n == 0) {
+    return 0;
+  }
+  if (n % 2 == 1) {
+    return sorted[n / 2];
+  }
+  return (sorted[n / 2 - 1] + (double)sorted[n / 2]) / 2;
+}
+
+// Nearest-rank percentile, 0 < p <= 100.
+inline double sortedPercentile(const unsigned long* sorted, size_t n,
+                               double p) {
+  if (n == 0) {
+    return 0;
+  }
+  size_t rank = (size_t)ceil(p / 100 * n);
+  if (rank < 1) {
+    rank = 1;
+  }
+  return sorted[rank - 1];
+}
+
+// Median absolute deviation from median. The deviations of a sorted array
+// grow outwards from the median, so they are merged from there without a
+// second buffer.
+inline double sortedMAD(const unsigned long* sorted, size_t n, double median) {
+  if (n == 0) {
+    return 0;
+  }
+  size_t right = 0;
+  while (right < n && sorted[right] < median) {
+    right++;
+  }
+  size_t left = right;
+  double lower = 0;
+  double upper = 0;
+  for (size_t k = 0; k <= n / 2; k++) {
+    double deviation;
+    if (left > 0 &&
+        (right >= n || median - sorted[left - 1] <= sorted[right] - median)) {
+      deviation = median - sorted[--left];
+    } else {
+      deviation = sorted[right++] - median;
+    }
+    lower = upper;
+    upper = deviation;
+  }
+  return n % 2 == 1 ? upper : (lower + upper) / 2;
+}
+
+// Two-sided 97.5% quantile of Student's t distribution.
+inline double studentT975(size_t df) {
+  static const double table[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (df == 0) {
+    return 0;
+  }
+  if (df <= sizeof(table) / sizeof(table[0])) {
+    return table[df - 1];
+  }
+  return 1.96 + 2.4 / df;
+}
+
+inline void computeStats(unsigned long* samples, size_t n, Stats& stats) {
+  memset(&stats, 0, sizeof(stats));
+  if (n == 0) {
+    return;
+  }
+  sortSamples(samples, n);
+
+  stats.count = n;
+  stats.min = samples[0];
+  stats.max = samples[n - 1];
+  stats.median = sortedMedian(samples, n);
+  stats.p95 = sortedPercentile(samples, n, 95);
+  stats.p99 = sortedPercentile(samples, n, 99);
+  stats.mad = sortedMAD(samples, n, stats.median);
+
+  size_t first = 0;
+  size_t last = n;
+  if (statsOutlierThreshold > 0) {
+    double median = stats.median;
+    double spread = 1.4826 * stats.mad;
+    if (spread == 0) {
+      // Over half the samples are identical (common with cycle counters);
+      // fall back to the scaled mean absolute deviation.
+      double sum = 0;
+      for (size_t i = 0; i < n; i++) {
+        sum += fabs(samples[i] - median);
+      }
+      spread = 1.2533 * sum / n;
+    }
+    double limit = statsOutlierThreshold * spread;
+    while (first < last && median - samples[first] > limit) {
+      first++;
+    }
+    while (last > first && samples[last - 1] - median > limit) {
+      last--;
+    }
+  }
+  const unsigned long* kept = samples + first;
+  size_t count = last - first;
+  stats.rejected = n - count;
+
+  double sum = 0;
+  for (size_t i = 0; i < count; i++) {
+    sum += kept[i];
+  }
+  stats.mean = sum / count;
+
+  double squares = 0;
+  for (size_t i = 0; i < count; i++) {
+    double delta = kept[i] - stats.mean;
+    squares += delta * delta;
+  }
+  stats.stdev = count > 1 ? sqrt(squares / (count - 1)) : 0;
+
+  double halfWidth =
+      studentT975(count - 1) * stats.stdev / sqrt((double)count);
+  stats.ciLow = stats.mean - halfWidth;
+  stats.ciHigh = stats.mean + halfWidth;
+}
+
+// Prints one line per figure; times in microseconds with cycles and
+// cycles/byte for bytes of input per sample.
+inline void printStats(const Stats& stats, unsigned long bytes) {
+  Serial.print("Samples: ");
+  Serial.print((unsigned long)stats.count);
+  Serial.print(" (");
+  Serial.print((unsigned long)stats.rejected);
+  Serial.println(" outliers left out of the mean)");
+  Serial.print("Min: ");
+  printDuration(stats.min, bytes);
+  Serial.print("Median: ");
+  printDuration(stats.median, bytes);
+  Serial.print("P95: ");
+  printDuration(stats.p95, bytes);
+  Serial.print("P99: ");
+  printDuration(stats.p99, bytes);
+  Serial.print("Max: ");
+  printDuration(stats.max, bytes);
+  Serial.print("Mean: ");
+  printDuration(stats.mean, bytes);
+  Serial.print("95% CI of Mean: ");
+  Serial.print(Timer::toMicros(stats.ciLow), 2);
+  Serial.print(" - ");
+  Serial.print(Timer::toMicros(stats.ciHigh), 2);
+  Serial.println(" microseconds");
+  Serial.print("Stdev: ");
+  Serial.print(Timer::toMicros(stats.stdev), 2);
+  Serial.println(" microseconds");
+  Serial.print("MAD: ");
+  Serial.print(Timer::toMicros(stats.mad), 2);
+  Serial.println(" microseconds");
+}
+
+#endif
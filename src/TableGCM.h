@@ -0,0 +1,372 @@
+// GCM with table-driven GHASH (Shoup's method) as a drop-in for GCM<T>.
+//
+//   TableGCM<AES128> gcm;     // 4-bit tables: 256 bytes per key
+//   TableGCM<AES128, 8> gcm;  // 8-bit tables: 4 KB per key, about 2x faster
+//
+// The stock GCM multiplies in GF(2^128) one bit at a time, which dominates
+// AES-GCM on the ESP8266. setKey() here precomputes the multiples of H for
+// every nibble (or byte) value, so a block takes 32 (or 16) table lookups
+// and shifts instead. TABLE_GCM_BITS sets the default table width. The
+// tables are key material and are wiped by clear().
+#ifndef TABLE_GCM_H
+#define TABLE_GCM_H
+
+#include <Arduino.h>
+#include <AuthenticatedCipher.h>
+#include <BlockCipher.h>
+#include <Crypto.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef TABLE_GCM_BITS
+#define TABLE_GCM_BITS 4
+#endif
+
+// Reduction of the bits shifted out at the low end, for 4 and 8 bit shifts.
+// clang-format off
+static const uint16_t tableGCMLast4[16] = {
+    0x0000, 0x1C20, 0x3840, 0x2460, 0x7080, 0x6CA0, 0x48C0, 0x54E0,
+    0xE100, 0xFD20, 0xD940, 0xC560, 0x9180, 0x8DA0, 0xA9C0, 0xB5E0};
+static const uint16_t tableGCMLast8[256] = {
+    0x0000, 0x01C2, 0x0384, 0x0246, 0x0708, 0x06CA, 0x048C, 0x054E,
+    0x0E10, 0x0FD2, 0x0D94, 0x0C56, 0x0918, 0x08DA, 0x0A9C, 0x0B5E,
+    0x1C20, 0x1DE2, 0x1FA4, 0x1E66, 0x1B28, 0x1AEA, 0x18AC, 0x196E,
+    0x1230, 0x13F2, 0x11B4, 0x1076, 0x1538, 0x14FA, 0x16BC, 0x177E,
+    0x3840, 0x3982, 0x3BC4, 0x3A06, 0x3F48, 0x3E8A, 0x3CCC, 0x3D0E,
+    0x3650, 0x3792, 0x35D4, 0x3416, 0x3158, 0x309A, 0x32DC, 0x331E,
+    0x2460, 0x25A2, 0x27E4, 0x2626, 0x2368, 0x22AA, 0x20EC, 0x212E,
+    0x2A70, 0x2BB2, 0x29F4, 0x2836, 0x2D78, 0x2CBA, 0x2EFC, 0x2F3E,
+    0x7080, 0x7142, 0x7304, 0x72C6, 0x7788, 0x764A, 0x740C, 0x75CE,
+    0x7E90, 0x7F52, 0x7D14, 0x7CD6, 0x7998, 0x785A, 0x7A1C, 0x7BDE,
+    0x6CA0, 0x6D62, 0x6F24, 0x6EE6, 0x6BA8, 0x6A6A, 0x682C, 0x69EE,
+    0x62B0, 0x6372, 0x6134, 0x60F6, 0x65B8, 0x647A, 0x663C, 0x67FE,
+    0x48C0, 0x4902, 0x4B44, 0x4A86, 0x4FC8, 0x4E0A, 0x4C4C, 0x4D8E,
+    0x46D0, 0x4712, 0x4554, 0x4496, 0x41D8, 0x401A, 0x425C, 0x439E,
+    0x54E0, 0x5522, 0x5764, 0x56A6, 0x53E8, 0x522A, 0x506C, 0x51AE,
+    0x5AF0, 0x5B32, 0x5974, 0x58B6, 0x5DF8, 0x5C3A, 0x5E7C, 0x5FBE,
+    0xE100, 0xE0C2, 0xE284, 0xE346, 0xE608, 0xE7CA, 0xE58C, 0xE44E,
+    0xEF10, 0xEED2, 0xEC94, 0xED56, 0xE818, 0xE9DA, 0xEB9C, 0xEA5E,
+    0xFD20, 0xFCE2, 0xFEA4, 0xFF66, 0xFA28, 0xFBEA, 0xF9AC, 0xF86E,
+    0xF330, 0xF2F2, 0xF0B4, 0xF176, 0xF438, 0xF5FA, 0xF7BC, 0xF67E,
+    0xD940, 0xD882, 0xDAC4, 0xDB06, 0xDE48, 0xDF8A, 0xDDCC, 0xDC0E,
+    0xD750, 0xD692, 0xD4D4, 0xD516, 0xD058, 0xD19A, 0xD3DC, 0xD21E,
+    0xC560, 0xC4A2, 0xC6E4, 0xC726, 0xC268, 0xC3AA, 0xC1EC, 0xC02E,
+    0xCB70, 0xCAB2, 0xC8F4, 0xC936, 0xCC78, 0xCDBA, 0xCFFC, 0xCE3E,
+    0x9180, 0x9042, 0x9204, 0x93C6, 0x9688, 0x974A, 0x950C, 0x94CE,
+    0x9F90, 0x9E52, 0x9C14, 0x9DD6, 0x9898, 0x995A, 0x9B1C, 0x9ADE,
+    0x8DA0, 0x8C62, 0x8E24, 0x8FE6, 0x8AA8, 0x8B6A, 0x892C, 0x88EE,
+    0x83B0, 0x8272, 0x8034, 0x81F6, 0x84B8, 0x857A, 0x873C, 0x86FE,
+    0xA9C0, 0xA802, 0xAA44, 0xAB86, 0xAEC8, 0xAF0A, 0xAD4C, 0xAC8E,
+    0xA7D0, 0xA612, 0xA454, 0xA596, 0xA0D8, 0xA11A, 0xA35C, 0xA29E,
+    0xB5E0, 0xB422, 0xB664, 0xB7A6, 0xB2E8, 0xB32A, 0xB16C, 0xB0AE,
+    0xBBF0, 0xBA32, 0xB874, 0xB9B6, 0xBCF8, 0xBD3A, 0xBF7C, 0xBEBE};
+// clang-format on
+
+inline uint64_t tableGCMLoad(const byte* data) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
+
+inline void tableGCMStore(byte* data, uint64_t value) {
+  for (int i = 7; i >= 0; i--) {
+    data[i] = (byte)value;
+    value >>= 8;
+  }
+}
+
+// Multiples of H indexed by Bits-wide chunks of the other operand; the high
+// and low 64 bits of each 128-bit multiple are kept in separate arrays.
+template <int Bits>
+class GHASHTable {
+ public:
+  static const int entries = 1 << Bits;
+
+  void init(const byte* h) {
+    uint64_t vh = tableGCMLoad(h);
+    uint64_t vl = tableGCMLoad(h + 8);
+    high[0] = 0;
+    low[0] = 0;
+    high[entries / 2] = vh;
+    low[entries / 2] = vl;
+    // H * x^k for the single-bit indices, then every other index as a sum.
+    for (int i = entries / 4; i > 0; i >>= 1) {
+      uint64_t reduce = (vl & 1) ? 0xE100000000000000ULL : 0;
+      vl = (vh << 63) | (vl >> 1);
+      vh = (vh >> 1) ^ reduce;
+      high[i] = vh;
+      low[i] = vl;
+    }
+    for (int i = 2; i < entries; i <<= 1) {
+      for (int j = 1; j < i; j++) {
+        high[i + j] = high[i] ^ high[j];
+        low[i + j] = low[i] ^ low[j];
+      }
+    }
+  }
+
+  // x = x * H.
+  void mult(byte* x) const;
+
+  void clear() {
+    clean(high, sizeof(high));
+    clean(low, sizeof(low));
+  }
+
+ private:
+  uint64_t high[entries];
+  uint64_t low[entries];
+};
+
+template <>
+inline void GHASHTable<4>::mult(byte* x) const {
+  uint64_t zh = high[x[15] & 0x0F];
+  uint64_t zl = low[x[15] & 0x0F];
+  for (int i = 15; i >= 0; i--) {
+    byte lo = x[i] & 0x0F;
+    byte hi = x[i] >> 4;
+    byte rem;
+    if (i != 15) {
+      rem = zl & 0x0F;
+      zl = (zh << 60) | (zl >> 4);
+      zh = (zh >> 4) ^ ((uint64_t)tableGCMLast4[rem] << 48);
+      zh ^= high[lo];
+      zl ^= low[lo];
+    }
+    rem = zl & 0x0F;
+    zl = (zh << 60) | (zl >> 4);
+    zh = (zh >> 4) ^ ((uint64_t)tableGCMLast4[rem] << 48);
+    zh ^= high[hi];
+    zl ^= low[hi];
+  }
+  tableGCMStore(x, zh);
+  tableGCMStore(x + 8, zl);
+}
+
+template <>
+inline void GHASHTable<8>::mult(byte* x) const {
+  uint64_t zh = high[x[15]];
+  uint64_t zl = low[x[15]];
+  for (int i = 14; i >= 0; i--) {
+    byte rem = zl & 0xFF;
+    zl = (zh << 56) | (zl >> 8);
+    zh = (zh >> 8) ^ ((uint64_t)tableGCMLast8[rem] << 48);
+    zh ^= high[x[i]];
+    zl ^= low[x[i]];
+  }
+  tableGCMStore(x, zh);
+  tableGCMStore(x + 8, zl);
+}
+
+// Same interface and output as GCMCommon; the block cipher is set by the
+// TableGCM<T> wrapper. Multiplier is the GHASH multiply by H: anything with
+// init(h), mult(x) and clear() like GHASHTable<Bits>.
+template <typename Multiplier>
+class TableGCMCommon : public AuthenticatedCipher {
+ public:
+  TableGCMCommon() : blockCipher(NULL) { clearState(); }
+  // The block cipher belongs to TableGCM<T> and is already gone here.
+  virtual ~TableGCMCommon() {
+    table.clear();
+    clearState();
+  }
+
+  size_t keySize() const { return blockCipher->keySize(); }
+  size_t ivSize() const { return 12; }
+  size_t tagSize() const { return 16; }
+
+  // Bytes of per-key multiplication tables.
+  static size_t tableSize() { return sizeof(Multiplier); }
+
+  bool setKey(const uint8_t* key, size_t len) {
+    if (!blockCipher->setKey(key, len)) {
+      return false;
+    }
+    byte h[16];
+    memset(h, 0, sizeof(h));
+    blockCipher->encryptBlock(h, h);
+    table.init(h);
+    clean(h, sizeof(h));
+    return true;
+  }
+
+  bool setIV(const uint8_t* iv, size_t len) {
+    if (len == 0) {
+      return false;
+    }
+    clearState();
+    if (len == 12) {
+      memcpy(counter, iv, 12);
+      counter[15] = 1;
+    } else {
+      // J0 = GHASH(IV || padding || [len(IV) in bits]_64).
+      hash(iv, len);
+      pad();
+      byte lengths[16];
+      memset(lengths, 0, sizeof(lengths));
+      tableGCMStore(lengths + 8, (uint64_t)len * 8);
+      hash(lengths, sizeof(lengths));
+      memcpy(counter, y, 16);
+      memset(y, 0, sizeof(y));
+    }
+    blockCipher->encryptBlock(tagMask, counter);
+    return true;
+  }
+
+  void encrypt(uint8_t* output, const uint8_t* input, size_t len) {
+    startData();
+    crypt(output, input, len);
+    hash(output, len);
+    dataSize += len;
+  }
+
+  void decrypt(uint8_t* output, const uint8_t* input, size_t len) {
+    startData();
+    hash(input, len);
+    crypt(output, input, len);
+    dataSize += len;
+  }
+
+  // As in GCMCommon, authenticated data must come before any payload.
+  void addAuthData(const void* data, size_t len) {
+    if (!dataStarted) {
+      hash((const byte*)data, len);
+      authSize += len;
+    }
+  }
+
+  void computeTag(void* tag, size_t len) {
+    startData();
+    pad();
+    byte lengths[16];
+    tableGCMStore(lengths, authSize * 8);
+    tableGCMStore(lengths + 8, dataSize * 8);
+    hash(lengths, sizeof(lengths));
+    for (int i = 0; i < 16; i++) {
+      y[i] ^= tagMask[i];
+    }
+    memcpy(tag, y, len < 16 ? len : 16);
+  }
+
+  bool checkTag(const void* tag, size_t len) {
+    if (len > 16) {
+      return false;
+    }
+    byte expected[16];
+    computeTag(expected, len);
+    bool valid = secure_compare(expected, tag, len);
+    clean(expected, sizeof(expected));
+    return valid;
+  }
+
+  void clear() {
+    if (blockCipher != NULL) {
+      blockCipher->clear();
+    }
+    table.clear();
+    clearState();
+  }
+
+ protected:
+  void setBlockCipher(BlockCipher* cipher) { blockCipher = cipher; }
+
+ private:
+  void clearState() {
+    clean(y, sizeof(y));
+    clean(counter, sizeof(counter));
+    clean(keystream, sizeof(keystream));
+    clean(tagMask, sizeof(tagMask));
+    hashPosn = 0;
+    keystreamPosn = 16;
+    authSize = 0;
+    dataSize = 0;
+    dataStarted = false;
+  }
+
+  // GCM pads the authenticated data to a whole block before the payload.
+  void startData() {
+    if (!dataStarted) {
+      pad();
+      dataStarted = true;
+    }
+  }
+
+  // GHASH update, XORing straight into the accumulator.
+  void hash(const byte* data, size_t len) {
+    while (len > 0) {
+      if (hashPosn == 0 && len >= 16) {
+        for (int i = 0; i < 16; i++) {
+          y[i] ^= data[i];
+        }
+        table.mult(y);
+        data += 16;
+        len -= 16;
+        continue;
+      }
+      y[hashPosn++] ^= *data++;
+      len--;
+      if (hashPosn == 16) {
+        table.mult(y);
+        hashPosn = 0;
+      }
+    }
+  }
+
+  void pad() {
+    if (hashPosn != 0) {
+      table.mult(y);
+      hashPosn = 0;
+    }
+  }
+
+  // CTR with the 32-bit big-endian counter of GCM.
+  void crypt(byte* output, const byte* input, size_t len) {
+    while (len > 0) {
+      if (keystreamPosn == 16) {
+        for (int i = 15; i >= 12; i--) {
+          if (++counter[i] != 0) {
+            break;
+          }
+        }
+        blockCipher->encryptBlock(keystream, counter);
+        keystreamPosn = 0;
+      }
+      size_t n = 16 - keystreamPosn;
+      if (n > len) {
+        n = len;
+      }
+      for (size_t i = 0; i < n; i++) {
+        output[i] = input[i] ^ keystream[keystreamPosn + i];
+      }
+      keystreamPosn += n;
+      output += n;
+      input += n;
+      len -= n;
+    }
+  }
+
+  BlockCipher* blockCipher;
+  Multiplier table;
+  byte y[16];
+  byte counter[16];
+  byte keystream[16];
+  byte tagMask[16];
+  uint8_t hashPosn;
+  uint8_t keystreamPosn;
+  bool dataStarted;
+  uint64_t authSize;
+  uint64_t dataSize;
+};
+
+template <typename T, int Bits = TABLE_GCM_BITS>
+class TableGCM : public TableGCMCommon<GHASHTable<Bits>> {
+ public:
+  TableGCM() { this->setBlockCipher(&cipher); }
+
+ private:
+  T cipher;
+};
+
+#endif
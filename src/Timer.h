@@ -0,0 +1,170 @@
+// Cycle-resolution timing for the benchmark suites.
+//
+//   Timer::begin();                      // once in setup()
+//   unsigned long start = Timer::now();
+//   ...
+//   unsigned long ticks = Timer::now() - start;
+//   printDuration(ticks, bytes);         // microseconds, cycles, cycles/byte
+//
+// Backends:
+//   ESP8266  CCOUNT special register, one tick per CPU cycle at 80 or 160 MHz
+//   AVR      Timer1 at clk/1, extended to 32 bits by its overflow interrupt
+//   x86 host rdtsc, calibrated against clock_gettime in begin(); the TSC
+//            runs at a fixed rate, not the core clock, so cycles need
+//            -D TIMER_CPU_MHZ=... here too
+//   host     clock_gettime(CLOCK_MONOTONIC) in nanoseconds (also with
+//            -D TIMER_CLOCK_GETTIME); cycles need -D TIMER_CPU_MHZ=...
+//
+// Tick differences are only valid while they fit in an unsigned long, i.e.
+// for intervals below 2^32 cycles on the boards (26 s at 160 MHz).
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <Arduino.h>
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#elif !defined(ESP8266) && !defined(TIMER_CLOCK_GETTIME) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define TIMER_RDTSC
+#include <x86intrin.h>
+#endif
+
+#ifndef TIMER_CPU_MHZ
+#define TIMER_CPU_MHZ 0
+#endif
+
+// Ticks per microsecond and CPU cycles per tick (0 if the clock is unknown).
+static double timerTicksPerMicro = 1;
+static double timerCyclesPerTick = 0;
+
+#if defined(__AVR__)
+static volatile uint16_t timer1Overflows = 0;
+
+ISR(TIMER1_OVF_vect) { timer1Overflows++; }
+#endif
+
+class Timer {
+ public:
+  static void begin() {
+#if defined(ESP8266)
+    timerTicksPerMicro = ESP.getCpuFreqMHz();
+    timerCyclesPerTick = 1;
+#elif defined(__AVR__)
+    // Normal mode, no prescaler: TCNT1 counts CPU cycles.
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    TCNT1 = 0;
+    TIFR1 = _BV(TOV1);
+    TIMSK1 = _BV(TOIE1);
+    timerTicksPerMicro = F_CPU / 1000000UL;
+    timerCyclesPerTick = 1;
+#elif defined(TIMER_RDTSC)
+    uint64_t startNanos = nanos();
+    uint64_t startTicks = __rdtsc();
+    while (nanos() - startNanos < 20000000ull) {
+    }
+    uint64_t elapsedTicks = __rdtsc() - startTicks;
+    uint64_t elapsedNanos = nanos() - startNanos;
+    timerTicksPerMicro = elapsedTicks * 1000.0 / elapsedNanos;
+    timerCyclesPerTick = TIMER_CPU_MHZ / timerTicksPerMicro;
+#elif defined(__linux__) || defined(__APPLE__)
+    timerTicksPerMicro = 1000;
+    timerCyclesPerTick = TIMER_CPU_MHZ / 1000.0;
+#else
+    timerTicksPerMicro = 1;
+    timerCyclesPerTick = TIMER_CPU_MHZ;
+#endif
+  }
+
+  static unsigned long now() {
+#if defined(ESP8266)
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+    return ccount;
+#elif defined(__AVR__)
+    uint8_t sreg = SREG;
+    cli();
+    uint16_t low = TCNT1;
+    uint16_t high = timer1Overflows;
+    // An overflow that happened after cli() has not been counted yet.
+    if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+      high++;
+    }
+    SREG = sreg;
+    return ((unsigned long)high << 16) | low;
+#elif defined(TIMER_RDTSC)
+    return (unsigned long)__rdtsc();
+#elif defined(__linux__) || defined(__APPLE__)
+    return (unsigned long)nanos();
+#else
+    return micros();
+#endif
+  }
+
+  static const char* name() {
+#if defined(ESP8266)
+    return "ccount";
+#elif defined(__AVR__)
+    return "timer1";
+#elif defined(TIMER_RDTSC)
+    return "rdtsc";
+#elif defined(__linux__) || defined(__APPLE__)
+    return "clock_gettime";
+#else
+    return "micros";
+#endif
+  }
+
+  static double toMicros(double ticks) { return ticks / timerTicksPerMicro; }
+
+  static bool hasCycles() { return timerCyclesPerTick != 0; }
+
+  static double toCycles(double ticks) { return ticks * timerCyclesPerTick; }
+
+  // Core clock in MHz as seen by this backend, 0 if unknown.
+  static double cpuMHz() { return timerTicksPerMicro * timerCyclesPerTick; }
+};
+
+// Prints "x microseconds (y cycles, z cycles/byte)" for ticks spent on bytes
+// of input; cycles are left out if the backend cannot provide them.
+inline void printDuration(double ticks, unsigned long bytes) {
+  Serial.print(Timer::toMicros(ticks), 2);
+  Serial.print(" microseconds");
+  if (Timer::hasCycles()) {
+    double cycles = Timer::toCycles(ticks);
+    Serial.print(" (");
+    Serial.print((unsigned long)(cycles + 0.5));
+    Serial.print(" cycles");
+    if (bytes != 0) {
+      Serial.print(", ");
+      Serial.print(cycles / bytes, 1);
+      Serial.print(" cycles/byte");
+    }
+    Serial.print(")");
+  }
+  Serial.println();
+}
+
+// Prints one header line identifying the timer and clock behind a report.
+inline void printTimerInfo() {
+  Serial.print("Timer: ");
+  Serial.print(Timer::name());
+#if defined(TIMER_RDTSC)
+  Serial.print(", TSC ");
+  Serial.print(timerTicksPerMicro, 0);
+  Serial.print(" MHz");
+#endif
+  if (Timer::cpuMHz() != 0) {
+    Serial.print(", ");
+    Serial.print(Timer::cpuMHz(), 0);
+    Serial.print(" MHz");
+#if defined(TIMER_RDTSC)
+    Serial.print(" core");
+#endif
+  }
+  Serial.println();
+}
+
+#endif
@@ -3,6 +3,14 @@
 #include <Crypto.h>
 #include <string.h>
 
+#include "InputPool.h"
+#include "Stats.h"
+#include "Timer.h"
+
+#if BENCH_TTABLE_AES
+#include "TTableAES.h"
+#endif
+
 struct TestVector {
   const char* name;
   byte key[32];
@@ -46,91 +54,111 @@ static TestVector testVectorAES256 = {
 AES128 aes128;
 AES192 aes192;
 AES256 aes256;
+#if BENCH_TTABLE_AES
+TTableAES128 ttableAES128;
+TTableAES192 ttableAES192;
+TTableAES256 ttableAES256;
+#endif
 
 byte buffer[16];
 
-unsigned long totalEncryptDecryptTime128 = 0;
-unsigned long totalEncryptDecryptTime192 = 0;
-unsigned long totalEncryptDecryptTime256 = 0;
-
-unsigned long individualEncryptDecryptTime128[100];
-unsigned long individualEncryptDecryptTime192[100];
-unsigned long individualEncryptDecryptTime256[100];
+// Samples of the cipher that ran last; printResults() reports them before the
+// next cipher reuses the arrays.
+unsigned long individualSetKeyTime[100];
+unsigned long individualEncryptionTime[100];
+unsigned long individualDecryptionTime[100];
 
 const int numIterations = 100;
 
-void printAsCSV(const char* algorithm, unsigned long* individualTimes) {
+InputPool<> inputPool;
+
+void printAsCSV(const char* algorithm, const char* label,
+                unsigned long* individualTimes) {
   Serial.print(algorithm);
   Serial.print(",");
+  Serial.print(label);
+  Serial.print(",");
   for (int i = 0; i < numIterations; i++) {
-    Serial.print(individualTimes[i]);
+    Serial.print(Timer::toMicros(individualTimes[i]), 2);
     Serial.print(",");
   }
   Serial.println();
 }
 
-void setRandomPlaintext(byte* plaintext) {
-  randomSeed(analogRead(0));
-  for (int i = 0; i < 16; i++) {
-    plaintext[i] = random(256);
-  }
-}
-
-void runExperiment(BlockCipher* cipher, struct TestVector* test,
-                   unsigned long& totalEncryptDecryptTime,
-                   unsigned long* individualEncryptDecryptTime) {
+void runExperiment(BlockCipher* cipher, struct TestVector* test) {
   crypto_feed_watchdog();
 
   for (int i = 0; i < numIterations; i++) {
-    unsigned long start = micros();
-
-    setRandomPlaintext(test->plaintext);
-    cipher->setKey(test->key, cipher->keySize());
+    const byte* key = test->key;
+    unsigned long start = Timer::now();
+    cipher->setKey(key, cipher->keySize());
+    individualSetKeyTime[i] = Timer::now() - start;
+  }
 
-    cipher->encryptBlock(buffer, buffer);
+  for (int i = 0; i < numIterations; i++) {
+    const byte* plaintext = inputPool[i].plaintext;
+    unsigned long start = Timer::now();
+    cipher->encryptBlock(buffer, plaintext);
+    individualEncryptionTime[i] = Timer::now() - start;
+  }
 
+  for (int i = 0; i < numIterations; i++) {
+    unsigned long start = Timer::now();
     cipher->decryptBlock(buffer, buffer);
-
-    unsigned long time = micros() - start;
-    individualEncryptDecryptTime[i] = time;
-    totalEncryptDecryptTime += time;
+    individualDecryptionTime[i] = Timer::now() - start;
   }
 }
 
-void printResults(const char* algorithm,
-                  unsigned long totalEncryptDecryptTime) {
+void printResults(const char* algorithm) {
+  Stats stats;
+
+  // As CSV first: computeStats() sorts the samples.
+  printAsCSV(algorithm, "Set Key Time", individualSetKeyTime);
+  printAsCSV(algorithm, "Encryption Time", individualEncryptionTime);
+  printAsCSV(algorithm, "Decryption Time", individualDecryptionTime);
+
   Serial.print("Algorithm: ");
   Serial.println(algorithm);
-  Serial.print("Average EncryptDecrypt Time: ");
-  Serial.print(totalEncryptDecryptTime / numIterations);
-  Serial.println(" microseconds");
+  Serial.println("Set Key Time");
+  computeStats(individualSetKeyTime, numIterations, stats);
+  printStats(stats, 0);
+  Serial.println("Encryption Time");
+  computeStats(individualEncryptionTime, numIterations, stats);
+  printStats(stats, sizeof(buffer));
+  Serial.println("Decryption Time");
+  computeStats(individualDecryptionTime, numIterations, stats);
+  printStats(stats, sizeof(buffer));
   Serial.println();
 }
 
 void setup() {
   Serial.begin(9600);
+  Timer::begin();
+  printTimerInfo();
+  inputPool.fill();
   Serial.println();
 
-  runExperiment(&aes128, &testVectorAES128, totalEncryptDecryptTime128,
-                individualEncryptDecryptTime128);
+  runExperiment(&aes128, &testVectorAES128);
+  printResults("AES-128");
 
   // Run experiment for AES-192
-  runExperiment(&aes192, &testVectorAES192, totalEncryptDecryptTime192,
-                individualEncryptDecryptTime192);
+  runExperiment(&aes192, &testVectorAES192);
+  printResults("AES-192");
 
   // Run experiment for AES-256
-  runExperiment(&aes256, &testVectorAES256, totalEncryptDecryptTime256,
-                individualEncryptDecryptTime256);
-
-  // Print results
-  printResults("AES-128", totalEncryptDecryptTime128);
-  printResults("AES-192", totalEncryptDecryptTime192);
-  printResults("AES-256", totalEncryptDecryptTime256);
-
-  // Print results as CSV
-  printAsCSV("AES-128", individualEncryptDecryptTime128);
-  printAsCSV("AES-192", individualEncryptDecryptTime192);
-  printAsCSV("AES-256", individualEncryptDecryptTime256);
+  runExperiment(&aes256, &testVectorAES256);
+  printResults("AES-256");
+
+#if BENCH_TTABLE_AES
+  // Same runs with the T-table AES.
+  printTTableAESInfo();
+  runExperiment(&ttableAES128, &testVectorAES128);
+  printResults("TAES-128");
+  runExperiment(&ttableAES192, &testVectorAES192);
+  printResults("TAES-192");
+  runExperiment(&ttableAES256, &testVectorAES256);
+  printResults("TAES-256");
+#endif
 }
 
 void loop() {}
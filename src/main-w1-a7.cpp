@@ -3,6 +3,14 @@
 #include <Crypto.h>
 #include <string.h>
 
+#include "InputPool.h"
+#include "Stats.h"
+#include "Timer.h"
+
+#if BENCH_TTABLE_AES
+#include "TTableAES.h"
+#endif
+
 struct TestVector {
   const char* name;
   byte key[32];
@@ -46,103 +54,130 @@ static TestVector testVectorAES256 = {
 AES128 aes128;
 AES192 aes192;
 AES256 aes256;
+#if BENCH_TTABLE_AES
+TTableAES128 ttableAES128;
+TTableAES192 ttableAES192;
+TTableAES256 ttableAES256;
+#endif
 
 byte buffer[16];
 
-unsigned long totalEncryptionTime128 = 0;
-unsigned long totalDecryptionTime128 = 0;
-unsigned long totalEncryptionTime192 = 0;
-unsigned long totalDecryptionTime192 = 0;
-unsigned long totalEncryptionTime256 = 0;
-unsigned long totalDecryptionTime256 = 0;
+unsigned long individualSetKeyTime128[100];
+unsigned long individualSetKeyTime192[100];
+unsigned long individualSetKeyTime256[100];
+unsigned long individualEncryptionTime128[100];
+unsigned long individualDecryptionTime128[100];
+unsigned long individualEncryptionTime192[100];
+unsigned long individualDecryptionTime192[100];
+unsigned long individualEncryptionTime256[100];
+unsigned long individualDecryptionTime256[100];
 
 const int numIterations = 100;
 
-void setRandomPlaintext(byte* plaintext) {
-  randomSeed(analogRead(0));
-  for (int i = 0; i < 16; i++) {
-    plaintext[i] = random(256);
-  }
-}
-
-void setRandomKey(byte* key, int keySize) {
-  randomSeed(analogRead(0));
-  for (int i = 0; i < keySize; i++) {
-    key[i] = random(256);
-  }
-}
+InputPool<> inputPool;
 
 void runExperiment(BlockCipher* cipher, struct TestVector* test,
-                   unsigned long& totalEncryptionTime,
-                   unsigned long& totalDecryptionTime);
+                   unsigned long* individualSetKeyTime,
+                   unsigned long* individualEncryptionTime,
+                   unsigned long* individualDecryptionTime);
 
-void printResults(const char* algorithm, unsigned long totalEncryptionTime,
-                  unsigned long totalDecryptionTime);
+void printResults(const char* algorithm, unsigned long* individualSetKeyTime,
+                  unsigned long* individualEncryptionTime,
+                  unsigned long* individualDecryptionTime);
 
 void setup() {
   Serial.begin(9600);
+  Timer::begin();
+  printTimerInfo();
+  inputPool.fill();
 
-  runExperiment(&aes128, &testVectorAES128, totalEncryptionTime128,
-                totalDecryptionTime128);
+  runExperiment(&aes128, &testVectorAES128, individualSetKeyTime128,
+                individualEncryptionTime128, individualDecryptionTime128);
 
   // Run experiment for AES-192
-  runExperiment(&aes192, &testVectorAES192, totalEncryptionTime192,
-                totalDecryptionTime192);
+  runExperiment(&aes192, &testVectorAES192, individualSetKeyTime192,
+                individualEncryptionTime192, individualDecryptionTime192);
 
   // Run experiment for AES-256
-  runExperiment(&aes256, &testVectorAES256, totalEncryptionTime256,
-                totalDecryptionTime256);
+  runExperiment(&aes256, &testVectorAES256, individualSetKeyTime256,
+                individualEncryptionTime256, individualDecryptionTime256);
 
   // Print results
-  printResults("AES-128", totalEncryptionTime128, totalDecryptionTime128);
-  printResults("AES-192", totalEncryptionTime192, totalDecryptionTime192);
-  printResults("AES-256", totalEncryptionTime256, totalDecryptionTime256);
+  printResults("AES-128", individualSetKeyTime128, individualEncryptionTime128,
+               individualDecryptionTime128);
+  printResults("AES-192", individualSetKeyTime192, individualEncryptionTime192,
+               individualDecryptionTime192);
+  printResults("AES-256", individualSetKeyTime256, individualEncryptionTime256,
+               individualDecryptionTime256);
+
+#if BENCH_TTABLE_AES
+  // Same runs with the T-table AES, reusing the sample arrays.
+  printTTableAESInfo();
+  runExperiment(&ttableAES128, &testVectorAES128, individualSetKeyTime128,
+                individualEncryptionTime128, individualDecryptionTime128);
+  runExperiment(&ttableAES192, &testVectorAES192, individualSetKeyTime192,
+                individualEncryptionTime192, individualDecryptionTime192);
+  runExperiment(&ttableAES256, &testVectorAES256, individualSetKeyTime256,
+                individualEncryptionTime256, individualDecryptionTime256);
+  printResults("TAES-128", individualSetKeyTime128, individualEncryptionTime128,
+               individualDecryptionTime128);
+  printResults("TAES-192", individualSetKeyTime192, individualEncryptionTime192,
+               individualDecryptionTime192);
+  printResults("TAES-256", individualSetKeyTime256, individualEncryptionTime256,
+               individualDecryptionTime256);
+#endif
 }
 
 void loop() {}
 
 void runExperiment(BlockCipher* cipher, struct TestVector* test,
-                   unsigned long& totalEncryptionTime,
-                   unsigned long& totalDecryptionTime) {
+                   unsigned long* individualSetKeyTime,
+                   unsigned long* individualEncryptionTime,
+                   unsigned long* individualDecryptionTime) {
   crypto_feed_watchdog();
 
   Serial.print(test->name);
   Serial.print(" Set Key ... \n");
   for (int i = 0; i < numIterations; i++) {
-    setRandomPlaintext(test->plaintext);
-    setRandomKey(test->key, cipher->keySize());
-    cipher->setKey(test->key, cipher->keySize());
+    const byte* key = inputPool[i].key;
+    unsigned long start = Timer::now();
+    cipher->setKey(key, cipher->keySize());
+    individualSetKeyTime[i] = Timer::now() - start;
   }
 
   Serial.print(test->name);
   Serial.print(" Encrypt ... \n");
-  unsigned long startEncryptionTime = micros();
   for (int i = 0; i < numIterations; i++) {
+    unsigned long start = Timer::now();
     cipher->encryptBlock(buffer, buffer);
+    individualEncryptionTime[i] = Timer::now() - start;
   }
-  unsigned long endEncryptionTime = micros();
-  totalEncryptionTime += endEncryptionTime - startEncryptionTime;
 
   Serial.print(test->name);
   Serial.print(" Decrypt ... \n");
-  unsigned long startDecryptionTime = micros();
   for (int i = 0; i < numIterations; i++) {
+    unsigned long start = Timer::now();
     cipher->decryptBlock(buffer, buffer);
+    individualDecryptionTime[i] = Timer::now() - start;
   }
-  unsigned long endDecryptionTime = micros();
-  totalDecryptionTime += endDecryptionTime - startDecryptionTime;
   Serial.println("");
 }
 
-void printResults(const char* algorithm, unsigned long totalEncryptionTime,
-                  unsigned long totalDecryptionTime) {
+void printResults(const char* algorithm, unsigned long* individualSetKeyTime,
+                  unsigned long* individualEncryptionTime,
+                  unsigned long* individualDecryptionTime) {
+  Stats stats;
+
   Serial.print("Algorithm: ");
   Serial.println(algorithm);
-  Serial.print("Average Encryption Time: ");
-  Serial.print(totalEncryptionTime / numIterations);
-  Serial.println(" microseconds");
-  Serial.print("Average Decryption Time: ");
-  Serial.print(totalDecryptionTime / numIterations);
-  Serial.println(" microseconds");
+  Serial.println("Set Key Time");
+  computeStats(individualSetKeyTime, numIterations, stats);
+  printStats(stats, 0);
+  Serial.println("Encryption Time");
+  computeStats(individualEncryptionTime, numIterations, stats);
+  printStats(stats, sizeof(buffer));
+  Serial.println("Decryption Time");
+  computeStats(individualDecryptionTime, numIterations, stats);
+  printStats(stats, sizeof(buffer));
   Serial.println();
 }
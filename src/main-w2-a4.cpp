@@ -1,435 +1,873 @@
-#include <AES.h>
 #include <Arduino.h>
-#include <CTR.h>
-#include <Crypto.h>
-#include <EAX.h>
-#include <GCM.h>
-#include <SHA256.h>
-#include <SHA512.h>
-#include <XTS.h>
-#include <string.h>
+
+#include "Arena.h"
+#include "Bench.h"
+#include "Footprint.h"
+#include "InputPool.h"
+#include "KeyCache.h"
+#include "PayloadSweep.h"
+#include "ResultStream.h"
+#include "Stats.h"
 
 struct TestVector {
   const char* name;
-  byte key[32];
   size_t plaintextSize;
-  int* plaintext;
+  byte* plaintext;
+  byte* ciphertext;
 };
 
-size_t testSizeArray[] = {1024, 2048, 4096, 8192};
-
-size_t testSize = 1024;
+// XTS has its own sector-size sweep in XTSSuite. TableGCMMode can be added
+// (or swapped for GCMMode) here.
+typedef Matrix<Modes<ECBMode, CTRMode, EAXMode, GCMMode>,
+               Ciphers<BENCH_CIPHERS>>
+    Suite;
+
+// Bitsliced AES behind CTR<>, next to the AES-*-CTR cells of Suite.
+typedef Matrix<Modes<CTRMode>,
+               Ciphers<BitsliceAES128, BitsliceAES192, BitsliceAES256>>
+    BitsliceSuite;
+
+// Plain CTR first: its medians are the reference for the batched cells.
+typedef Matrix<Modes<CTRMode, BatchCTRMode<1>, BatchCTRMode<4>,
+                     BatchCTRMode<8>, BatchCTRMode<16>, BatchCTRMode<32>>,
+               Ciphers<AES128, AES256>>
+    BatchSuite;
+const int numBatchCiphers = 2;
+
+// Stock GCM against the table-driven GHASH variant and, with BENCH_AESNI, the
+// PCLMULQDQ one.
+#if BENCH_AESNI
+typedef Matrix<Modes<GCMMode, TableGCMMode, ClmulGCMMode>,
+               Ciphers<BENCH_CIPHERS>>
+    GCMSuite;
+#else
+typedef Matrix<Modes<GCMMode, TableGCMMode>, Ciphers<BENCH_CIPHERS>> GCMSuite;
+#endif
+
+// XTS over whole sectors, all key sizes.
+typedef Matrix<Modes<XTSMode>, Ciphers<BENCH_CIPHERS>> XTSSuite;
+
+// The library cell a cell has to agree with: batched CTR with CTR<>,
+// table-driven and PCLMULQDQ GHASH with stock GCM, AES-NI and bitsliced AES
+// with the library AES. Other cells are their own reference.
+template <typename T>
+struct Reference {
+  typedef T Type;
+};
 
-// clang-format off
-static TestVector testVectorAES128 = {
-    .name        = "AES-128-ECB",
-    .key         = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
-                    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F},
-    .plaintextSize = testSize,
-    .plaintext   = new int[testSize]        
+template <typename T>
+struct Reference<CTR<T>> {
+  typedef CTR<typename Reference<T>::Type> Type;
 };
-static TestVector testVectorAES192 = {
-    .name        = "AES-192-ECB",
-    .key         = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
-                    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
-                    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17},
-    .plaintextSize = testSize,
-    .plaintext   = new int[testSize]        
+
+template <typename T>
+struct Reference<EAX<T>> {
+  typedef EAX<typename Reference<T>::Type> Type;
 };
-static TestVector testVectorAES256 = {
-    .name        = "AES-256-ECB",
-    .key         = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
-                    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
-                    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17,
-                    0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F},
-    .plaintextSize = testSize,
-    .plaintext   = new int[testSize]       
+
+template <typename T>
+struct Reference<GCM<T>> {
+  typedef GCM<typename Reference<T>::Type> Type;
 };
-// clang-format on
-
-AES128 aes128;
-CTR<AES128> aes128ctr;
-EAX<AES128> aes128eax;
-GCM<AES128> aes128gcm;
-XTS<AES128> aes128xts;
-
-AES192 aes192;
-CTR<AES192> aes192ctr;
-EAX<AES192> aes192eax;
-GCM<AES192> aes192gcm;
-XTS<AES192> aes192xts;
-
-AES256 aes256;
-CTR<AES256> aes256ctr;
-EAX<AES256> aes256eax;
-GCM<AES256> aes256gcm;
-XTS<AES256> aes256xts;
 
-alignas(16) byte buffer[16] __attribute__((aligned(16)));
+template <typename T, size_t Batch>
+struct Reference<BatchCTR<T, Batch>> {
+  typedef CTR<typename Reference<T>::Type> Type;
+};
 
-unsigned long totalEncryptDecryptTime128 = 0;
-unsigned long totalEncryptDecryptTime192 = 0;
-unsigned long totalEncryptDecryptTime256 = 0;
+template <typename T, int Bits>
+struct Reference<TableGCM<T, Bits>> {
+  typedef GCM<typename Reference<T>::Type> Type;
+};
 
-unsigned long individualEncryptDecryptTime128[100];
-unsigned long individualEncryptDecryptTime192[100];
-unsigned long individualEncryptDecryptTime256[100];
+template <>
+struct Reference<BitsliceAES128> {
+  typedef AES128 Type;
+};
 
-void resetTotalEncryptDecryptTime() {
-  totalEncryptDecryptTime128 = 0;
-  totalEncryptDecryptTime192 = 0;
-  totalEncryptDecryptTime256 = 0;
-}
+template <>
+struct Reference<BitsliceAES192> {
+  typedef AES192 Type;
+};
 
-const int numIterations = 100;
+template <>
+struct Reference<BitsliceAES256> {
+  typedef AES256 Type;
+};
 
-void printAsCSV(const char* algorithm, unsigned long* individualTimes) {
-  Serial.print(algorithm);
-  Serial.print(",");
-  for (int i = 0; i < numIterations; i++) {
-    Serial.print(individualTimes[i]);
-    Serial.print(",");
-  }
-  Serial.println("\n");
-}
+#if BENCH_AESNI
+template <typename Portable>
+struct Reference<AESNI<Portable>> {
+  typedef Portable Type;
+};
 
-void resizeTestVector(TestVector* test, size_t newSize) {
-  delete[] test->plaintext;
-  test->plaintextSize = newSize;
-  test->plaintext = new int[newSize];
-}
+template <typename T>
+struct Reference<ClmulGCM<T>> {
+  typedef GCM<typename Reference<T>::Type> Type;
+};
+#endif
 
-void setRandomPlaintext(int* plaintext, size_t plaintextSize) {
-  randomSeed(analogRead(0));
-  for (unsigned int i = 0; i < plaintextSize; i++) {
-    plaintext[i] = random(256);
-  }
-}
+// Plain text sizes of the throughput test.
+#define BENCH_TEST_SIZES 1024, 2048, 4096, 8192
 
-void setRandomKey(byte* key, int keySize) {
-  randomSeed(analogRead(0));
-  for (int i = 0; i < keySize; i++) {
-    key[i] = random(256);
-  }
-}
+typedef Matrix<Modes<ECBMode, CTRMode, EAXMode, GCMMode>,
+               Ciphers<BENCH_CIPHERS>, Sizes<BENCH_TEST_SIZES>>
+    ThroughputSuite;
+typedef Matrix<Modes<CTRMode>,
+               Ciphers<BitsliceAES128, BitsliceAES192, BitsliceAES256>,
+               Sizes<BENCH_TEST_SIZES>>
+    BitsliceThroughputSuite;
 
-void runExperimentBlockCipher(BlockCipher* cipher, struct TestVector* test,
-                              unsigned long& totalEncryptDecryptTime,
-                              unsigned long* individualEncryptDecryptTime);
+constexpr size_t gcmSizeArray[] = {16, 64, 256, 1024, 4096, 8192};
 
-void printResults(const char* algorithm, unsigned long totalEncryptDecryptTime);
+constexpr size_t batchSizeArray[] = {16, 64, 256, 1024, 4096, 8192};
+const int numBatchSizes = sizeof(batchSizeArray) / sizeof(batchSizeArray[0]);
 
-void runExperimentCTR(Cipher* cipher, struct TestVector* test,
-                      unsigned long& totalEncryptDecryptTime,
-                      unsigned long* individualEncryptDecryptTime);
+// Disk sectors, and sizes that are no multiple of 16 and so end with
+// ciphertext stealing.
+constexpr size_t xtsSectorSizeArray[] = {512, 4096, 17, 100, 1000, 4095};
 
-void runExperimentEAX(AuthenticatedCipher* cipher, struct TestVector* test,
-                      unsigned long& totalEncryptDecryptTime,
-                      unsigned long* individualEncryptDecryptTime);
+constexpr size_t testSizeArray[] = {BENCH_TEST_SIZES};
 
-void runExperimentGCM(AuthenticatedCipher* cipher, struct TestVector* test,
-                      unsigned long& totalEncryptDecryptTime,
-                      unsigned long* individualEncryptDecryptTime);
+// Byte offsets of input and output from 16-byte alignment, as in packet
+// buffers, and the payload encrypted at each of them.
+size_t alignmentOffsetArray[] = {0, 1, 2, 3, 4, 8};
+const size_t maxAlignmentOffset = 8;
 
-void runExperimentXTS128(XTS<AES128>& cipher, struct TestVector* test,
-                         unsigned long& totalEncryptDecryptTime,
-                         unsigned long* individualEncryptDecryptTime);
+#ifndef ALIGNMENT_TEST_SIZE
+#define ALIGNMENT_TEST_SIZE 1024
+#endif
 
-void runExperimentXTS192(XTS<AES192>& cipher, struct TestVector* test,
-                         unsigned long& totalEncryptDecryptTime,
-                         unsigned long* individualEncryptDecryptTime);
+size_t testSize = 1024;
 
-void runExperimentXTS256(XTS<AES256>& cipher, struct TestVector* test,
-                         unsigned long& totalEncryptDecryptTime,
-                         unsigned long* individualEncryptDecryptTime);
+constexpr size_t maxOf(size_t a, size_t b) { return a > b ? a : b; }
 
-void setup() {
-  Serial.begin(9600);
-
-  for (unsigned int i = 0; i < sizeof(testSizeArray) / sizeof(testSizeArray[0]);
-       i++) {
-    resizeTestVector(&testVectorAES128, testSizeArray[i]);
-    resizeTestVector(&testVectorAES192, testSizeArray[i]);
-    resizeTestVector(&testVectorAES256, testSizeArray[i]);
-
-    Serial.print("--------------------\n");
-    Serial.print("--------------------\n");
-    Serial.print("--------------------\n");
-
-    Serial.print("Plain Text Size: " + String(testSizeArray[i]) + "\n");
-
-    Serial.print("Block Cipher Test\n");
-    // Run experiment for AES-128
-    runExperimentBlockCipher(&aes128, &testVectorAES128,
-                             totalEncryptDecryptTime128,
-                             individualEncryptDecryptTime128);
-
-    // Run experiment for AES-192
-    runExperimentBlockCipher(&aes192, &testVectorAES192,
-                             totalEncryptDecryptTime192,
-                             individualEncryptDecryptTime192);
-
-    // Run experiment for AES-256
-    runExperimentBlockCipher(&aes256, &testVectorAES256,
-                             totalEncryptDecryptTime256,
-                             individualEncryptDecryptTime256);
-
-    // Print results
-    printResults("AES-128", totalEncryptDecryptTime128);
-    printResults("AES-192", totalEncryptDecryptTime192);
-    printResults("AES-256", totalEncryptDecryptTime256);
-    resetTotalEncryptDecryptTime();
-
-    printAsCSV("AES-128", individualEncryptDecryptTime128);
-    printAsCSV("AES-192", individualEncryptDecryptTime192);
-    printAsCSV("AES-256", individualEncryptDecryptTime256);
-
-    Serial.print("CTR Cipher Mode Test\n");
-    // Run experiment for AES-128
-    runExperimentCTR(&aes128ctr, &testVectorAES128, totalEncryptDecryptTime128,
-                     individualEncryptDecryptTime128);
-
-    // Run experiment for AES-192
-    runExperimentCTR(&aes192ctr, &testVectorAES192, totalEncryptDecryptTime192,
-                     individualEncryptDecryptTime192);
-
-    // Run experiment for AES-256
-    runExperimentCTR(&aes256ctr, &testVectorAES256, totalEncryptDecryptTime256,
-                     individualEncryptDecryptTime256);
-
-    // Print results
-    printResults("AES-128-CTR", totalEncryptDecryptTime128);
-    printResults("AES-192-CTR", totalEncryptDecryptTime192);
-    printResults("AES-256-CTR", totalEncryptDecryptTime256);
-    resetTotalEncryptDecryptTime();
-
-    printAsCSV("AES-128-CTR", individualEncryptDecryptTime128);
-    printAsCSV("AES-192-CTR", individualEncryptDecryptTime192);
-    printAsCSV("AES-256-CTR", individualEncryptDecryptTime256);
-
-    Serial.print("EAX Cipher Mode Test\n");
-    // Run experiment for AES-128
-    runExperimentEAX(&aes128eax, &testVectorAES128, totalEncryptDecryptTime128,
-                     individualEncryptDecryptTime256);
-
-    // Run experiment for AES-192
-    runExperimentEAX(&aes192eax, &testVectorAES192, totalEncryptDecryptTime192,
-                     individualEncryptDecryptTime192);
-
-    // Run experiment for AES-256
-    runExperimentEAX(&aes256eax, &testVectorAES256, totalEncryptDecryptTime256,
-                     individualEncryptDecryptTime256);
-
-    // Print results
-    printResults("AES-128-EAX", totalEncryptDecryptTime128);
-    printResults("AES-192-EAX", totalEncryptDecryptTime192);
-    printResults("AES-256-EAX", totalEncryptDecryptTime256);
-    resetTotalEncryptDecryptTime();
-
-    printAsCSV("AES-128-EAX", individualEncryptDecryptTime128);
-    printAsCSV("AES-192-EAX", individualEncryptDecryptTime192);
-    printAsCSV("AES-256-EAX", individualEncryptDecryptTime256);
-
-    Serial.print("GCM Cipher Mode Test\n");
-    // Run experiment for AES-128
-    runExperimentGCM(&aes128gcm, &testVectorAES128, totalEncryptDecryptTime128,
-                     individualEncryptDecryptTime256);
-
-    // Run experiment for AES-192
-    runExperimentGCM(&aes192gcm, &testVectorAES192, totalEncryptDecryptTime192,
-                     individualEncryptDecryptTime192);
-
-    // Run experiment for AES-256
-    runExperimentGCM(&aes256gcm, &testVectorAES256, totalEncryptDecryptTime256,
-                     individualEncryptDecryptTime256);
-
-    // Print results
-    printResults("AES-128-GCM", totalEncryptDecryptTime128);
-    printResults("AES-192-GCM", totalEncryptDecryptTime192);
-    printResults("AES-256-GCM", totalEncryptDecryptTime256);
-    resetTotalEncryptDecryptTime();
-
-    printAsCSV("AES-128-GCM", individualEncryptDecryptTime128);
-    printAsCSV("AES-192-GCM", individualEncryptDecryptTime192);
-    printAsCSV("AES-256-GCM", individualEncryptDecryptTime256);
-
-    // Serial.print("XTS Cipher Mode Test\n");
-    // // Run experiment for AES-128
-    // runExperimentXTS128(aes128xts, &testVectorAES128,
-    // totalEncryptDecryptTime128,
-    //                     individualEncryptDecryptTime256);
-
-    // // Run experiment for AES-192
-    // runExperimentXTS192(aes192xts, &testVectorAES192,
-    // totalEncryptDecryptTime192,
-    //                     individualEncryptDecryptTime192);
-
-    // // Run experiment for AES-256
-    // runExperimentXTS256(aes256xts, &testVectorAES256,
-    // totalEncryptDecryptTime256,
-    //                     individualEncryptDecryptTime256);
-
-    // // Print results
-    // printResults("AES-128-XTS", totalEncryptDecryptTime128);
-    // printResults("AES-192-XTS", totalEncryptDecryptTime192);
-    // printResults("AES-256-XTS", totalEncryptDecryptTime256);
-    // resetTotalEncryptDecryptTime();
-
-    // printAsCSV("AES-128-XTS", individualEncryptDecryptTime128);
-    // printAsCSV("AES-192-XTS", individualEncryptDecryptTime192);
-    // printAsCSV("AES-256-XTS", individualEncryptDecryptTime256);
-  }
-  Serial.print("Done\n");
+template <size_t N>
+constexpr size_t maxSize(const size_t (&sizes)[N], size_t i = 0) {
+  return i + 1 == N ? sizes[i] : maxOf(sizes[i], maxSize(sizes, i + 1));
 }
 
-void loop() {}
+// Test vector size of the GHASH, batch CTR and XTS tests; XTS decrypts each
+// sector into the plaintext buffer behind the sector.
+constexpr size_t messageTestSize =
+    maxOf(maxOf(maxSize(gcmSizeArray), maxSize(batchSizeArray)),
+          2 * maxSize(xtsSectorSizeArray));
 
-void runExperimentBlockCipher(BlockCipher* cipher, struct TestVector* test,
-                              unsigned long& totalEncryptDecryptTime,
-                              unsigned long* individualEncryptDecryptTime) {
-  crypto_feed_watchdog();
+// Largest payload this build runs. The arena is static RAM for the whole
+// run, so it is sized from the size arrays, PAYLOAD_SWEEP_MAX and
+// ALIGNMENT_TEST_SIZE rather than a fixed maximum.
+constexpr size_t maxTestSize =
+    maxOf(maxOf(maxSize(testSizeArray), messageTestSize),
+          maxOf(PAYLOAD_SWEEP_MAX, ALIGNMENT_TEST_SIZE + maxAlignmentOffset));
 
-  for (int i = 0; i < numIterations; i++) {
-    unsigned long start = micros();
+// Plaintext and ciphertext of the test vector; resizeTestVector() takes
+// them from here instead of the heap.
+Arena<2 * maxTestSize> arena;
 
-    setRandomPlaintext(test->plaintext, test->plaintextSize);
+static TestVector testVector = {.name = "Plain Text",
+                                .plaintextSize = 0,
+                                .plaintext = NULL,
+                                .ciphertext = NULL};
 
-    cipher->setKey(test->key, cipher->keySize());
-    cipher->encryptBlock(buffer, buffer);
-    cipher->decryptBlock(buffer, buffer);
-
-    unsigned long time = micros() - start;
-    individualEncryptDecryptTime[i] = time;
-    totalEncryptDecryptTime += time;
-  }
-}
-
-void runExperimentCTR(Cipher* cipher, struct TestVector* test,
-                      unsigned long& totalEncryptDecryptTime,
-                      unsigned long* individualEncryptDecryptTime) {
-  crypto_feed_watchdog();
+alignas(16) byte buffer[16] __attribute__((aligned(16)));
 
-  for (int i = 0; i < numIterations; i++) {
-    unsigned long start = micros();
+const int numIterations = 100;
 
-    setRandomPlaintext(test->plaintext, test->plaintextSize);
+InputPool<> inputPool;
 
-    cipher->setKey(test->key, cipher->keySize());
-    cipher->encrypt(buffer, buffer, sizeof(test->plaintext));
-    cipher->decrypt(buffer, buffer, sizeof(test->plaintext));
+// Contexts per cell in the key cache test, and how many devices (distinct
+// keys) the simulated gateway serves in turn.
+#ifndef KEY_CACHE_CAPACITY
+#define KEY_CACHE_CAPACITY 16
+#endif
+#ifndef KEY_CACHE_DEVICES
+#define KEY_CACHE_DEVICES KEY_CACHE_CAPACITY
+#endif
 
-    unsigned long time = micros() - start;
-    individualEncryptDecryptTime[i] = time;
-    totalEncryptDecryptTime += time;
-  }
-}
+// Length of the cross-check: odd, so stream modes end on a partial block,
+// and longer than two 32-block batches.
+const size_t verifySize = 2 * 32 * 16 + 5;
+static_assert(2 * verifySize <= messageTestSize,
+              "the cross-check runs on the message test vector");
 
-void runExperimentEAX(AuthenticatedCipher* cipher, struct TestVector* test,
-                      unsigned long& totalEncryptDecryptTime,
-                      unsigned long* individualEncryptDecryptTime) {
-  crypto_feed_watchdog();
+// Each throughput pass moves numThroughputIterations * plaintextSize bytes.
+const int numThroughputIterations = 16;
 
+void printAsCSV(const char* algorithm, const char* label,
+                unsigned long* individualTimes) {
+  Serial.print(algorithm);
+  Serial.print(",");
+  Serial.print(label);
+  Serial.print(",");
   for (int i = 0; i < numIterations; i++) {
-    unsigned long start = micros();
-
-    setRandomPlaintext(test->plaintext, test->plaintextSize);
-
-    cipher->setKey(test->key, cipher->keySize());
-    cipher->encrypt(buffer, buffer, sizeof(test->plaintext));
-    cipher->decrypt(buffer, buffer, sizeof(test->plaintext));
-
-    unsigned long time = micros() - start;
-    individualEncryptDecryptTime[i] = time;
-    totalEncryptDecryptTime += time;
+    Serial.print(Timer::toMicros(individualTimes[i]), 2);
+    Serial.print(",");
   }
+  Serial.println("\n");
 }
 
-void runExperimentGCM(AuthenticatedCipher* cipher, struct TestVector* test,
-                      unsigned long& totalEncryptDecryptTime,
-                      unsigned long* individualEncryptDecryptTime) {
-  crypto_feed_watchdog();
-
-  for (int i = 0; i < numIterations; i++) {
-    unsigned long start = micros();
-
-    setRandomPlaintext(test->plaintext, test->plaintextSize);
-
-    cipher->setKey(test->key, cipher->keySize());
-    cipher->encrypt(buffer, buffer, sizeof(test->plaintext));
-    cipher->decrypt(buffer, buffer, sizeof(test->plaintext));
-
-    unsigned long time = micros() - start;
-    individualEncryptDecryptTime[i] = time;
-    totalEncryptDecryptTime += time;
-  }
+// newSize must not exceed maxTestSize.
+void resizeTestVector(TestVector* test, size_t newSize) {
+  arena.reset();
+  test->plaintextSize = newSize;
+  test->plaintext = arena.alloc<byte>(newSize);
+  test->ciphertext = arena.alloc<byte>(newSize);
 }
 
-void runExperimentXTS128(XTS<AES128>& cipher, struct TestVector* test,
-                         unsigned long& totalEncryptDecryptTime,
-                         unsigned long* individualEncryptDecryptTime) {
-  crypto_feed_watchdog();
+void printResults(const char* algorithm, unsigned long* individualSetKeyTime,
+                  unsigned long* individualSetIVTime,
+                  unsigned long* individualEncryptionTime,
+                  unsigned long* individualDecryptionTime,
+                  const Footprint& footprint);
+
+struct Experiment {
+  unsigned long individualSetKeyTime[numIterations];
+  unsigned long individualSetIVTime[numIterations];
+  unsigned long individualEncryptionTime[numIterations];
+  unsigned long individualDecryptionTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    benchSetSize(cipher, sizeof(buffer));
+    benchWarmup(cipher, buffer, buffer, sizeof(buffer));
+    Footprint footprint;
+    measureFootprint(cipher, buffer, sizeof(buffer), footprint);
+
+    resultStream.beginSeries(name, "Set Key Time", 0);
+    for (int i = 0; i < numIterations; i++) {
+      unsigned long start = Timer::now();
+      benchSetKey(cipher, benchKey);
+      individualSetKeyTime[i] = Timer::now() - start;
+      resultStream.add(individualSetKeyTime[i]);
+    }
+    resultStream.endSeries();
+
+    // IV/nonce setup; ECB has none.
+    bool hasIV = benchHasIV(cipher);
+    if (hasIV) {
+      resultStream.beginSeries(name, "Set IV Time", 0);
+      for (int i = 0; i < numIterations; i++) {
+        unsigned long start = Timer::now();
+        benchSetIV(cipher);
+        individualSetIVTime[i] = Timer::now() - start;
+        resultStream.add(individualSetIVTime[i]);
+      }
+      resultStream.endSeries();
+    }
+
+    resultStream.beginSeries(name, "Encryption Time", sizeof(buffer));
+    for (int i = 0; i < numIterations; i++) {
+      memcpy(buffer, inputPool[i].plaintext, sizeof(buffer));
+      unsigned long start = Timer::now();
+      benchEncrypt(cipher, buffer, buffer, sizeof(buffer));
+      individualEncryptionTime[i] = Timer::now() - start;
+      resultStream.add(individualEncryptionTime[i]);
+    }
+    resultStream.endSeries();
+
+    resultStream.beginSeries(name, "Decryption Time", sizeof(buffer));
+    for (int i = 0; i < numIterations; i++) {
+      unsigned long start = Timer::now();
+      benchDecrypt(cipher, buffer, buffer, sizeof(buffer));
+      individualDecryptionTime[i] = Timer::now() - start;
+      resultStream.add(individualDecryptionTime[i]);
+    }
+    resultStream.endSeries();
+
+    // The host decoder turns streamed series into CSV itself.
+    if (!resultStream.enabled()) {
+      printAsCSV(name, "Set Key Time", individualSetKeyTime);
+      if (hasIV) {
+        printAsCSV(name, "Set IV Time", individualSetIVTime);
+      }
+      printAsCSV(name, "Encryption Time", individualEncryptionTime);
+      printAsCSV(name, "Decryption Time", individualDecryptionTime);
+      printResults(name, individualSetKeyTime,
+                   hasIV ? individualSetIVTime : NULL,
+                   individualEncryptionTime, individualDecryptionTime,
+                   footprint);
+    }
+  }
+};
 
-  for (int i = 0; i < numIterations; i++) {
-    unsigned long start = micros();
+// Latency of one 16-byte message on a freshly constructed cipher object (as
+// after deep sleep) versus the same message in steady state. Build with
+// -D BENCH_EVICT_CACHES=1 to also start every cold sample with cold caches;
+// otherwise only the very first call sees a cold flash cache.
+// Encrypts verifySize bytes once with the cell and with its Reference, then
+// decrypts back; prints "Mismatch" if ciphertext, tag or round trip differ.
+// Needs 2 * verifySize bytes of plaintext.
+struct VerifyExperiment {
+  TestVector* test;
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    typename Reference<T>::Type reference;
+    byte* input = test->plaintext;
+    byte* expected = test->plaintext + verifySize;
+    byte* output = test->ciphertext;
+    byte expectedTag[16];
+    byte tag[16];
+
+    XorShift32 rng;
+    rng.fill(input, verifySize);
+    // ECB leaves the trailing partial block alone; this way it compares
+    // equal on both sides.
+    memcpy(expected, input, verifySize);
+    memcpy(output, input, verifySize);
+
+    benchSetSize(reference, verifySize);
+    benchSetKey(reference, benchKey);
+    benchSetIV(reference);
+    benchEncrypt(reference, expected, input, verifySize);
+    size_t tagSize = benchTag(reference, expectedTag);
+
+    benchSetSize(cipher, verifySize);
+    benchSetKey(cipher, benchKey);
+    benchSetIV(cipher);
+    benchEncrypt(cipher, output, input, verifySize);
+    bool ok = benchTag(cipher, tag) == tagSize &&
+              memcmp(tag, expectedTag, tagSize) == 0 &&
+              memcmp(output, expected, verifySize) == 0;
+
+    benchSetIV(cipher);
+    benchDecrypt(cipher, output, output, verifySize);
+    ok = ok && memcmp(output, input, verifySize) == 0;
+    if (!ok) {
+      Serial.print(name);
+      Serial.println(" Mismatch");
+    }
+  }
+};
 
-    setRandomPlaintext(test->plaintext, test->plaintextSize);
+struct ColdStartExperiment {
+  unsigned long coldTime[BENCH_COLD_RUNS];
+  unsigned long warmTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    for (int i = 0; i < BENCH_COLD_RUNS; i++) {
+      benchRecreate(cipher);
+      benchSetSize(cipher, sizeof(buffer));
+      benchEvictCaches();
+      memcpy(buffer, inputPool[i].plaintext, sizeof(buffer));
+
+      unsigned long start = Timer::now();
+      benchMessage(cipher, buffer, buffer, sizeof(buffer));
+      coldTime[i] = Timer::now() - start;
+    }
+    unsigned long firstCallTime = coldTime[0];
+
+    benchWarmup(cipher, buffer, buffer, sizeof(buffer));
+    for (int i = 0; i < numIterations; i++) {
+      memcpy(buffer, inputPool[i].plaintext, sizeof(buffer));
+
+      unsigned long start = Timer::now();
+      benchMessage(cipher, buffer, buffer, sizeof(buffer));
+      warmTime[i] = Timer::now() - start;
+    }
+
+    Stats stats;
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    Serial.print("First Call Time: ");
+    printDuration(firstCallTime, sizeof(buffer));
+    // Every cold run pays the misses this test is after, so none of them
+    // is an outlier; the mean keeps them all.
+    Serial.println("Cold Start Time");
+    double threshold = statsOutlierThreshold;
+    statsOutlierThreshold = 0;
+    computeStats(coldTime, BENCH_COLD_RUNS, stats);
+    statsOutlierThreshold = threshold;
+    printStats(stats, sizeof(buffer));
+    Serial.println("Steady State Time");
+    computeStats(warmTime, numIterations, stats);
+    printStats(stats, sizeof(buffer));
+    Serial.println();
+  }
+};
 
-    cipher.setKey(test->key, cipher.keySize());
-    cipher.encryptSector(buffer, buffer);
-    cipher.decryptSector(buffer, buffer);
+// Per-message latency of a gateway serving KEY_CACHE_DEVICES devices in turn:
+// expanding each device's key for every message versus looking its context
+// up in a KeyCache.
+struct KeyCacheExperiment {
+  unsigned long rekeyTime[numIterations];
+  unsigned long cachedTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    benchSetSize(cipher, sizeof(buffer));
+    for (int i = 0; i < numIterations; i++) {
+      const InputSlot& device = inputPool[i % KEY_CACHE_DEVICES];
+      memcpy(buffer, inputPool[i].plaintext, sizeof(buffer));
+
+      unsigned long start = Timer::now();
+      benchSetKey(cipher, device.key);
+      benchSetIV(cipher);
+      benchEncrypt(cipher, buffer, buffer, sizeof(buffer));
+      rekeyTime[i] = Timer::now() - start;
+    }
+
+    // On the heap: a cache per cell would not fit into static RAM.
+    KeyCache<T, KEY_CACHE_CAPACITY>* cache =
+        new KeyCache<T, KEY_CACHE_CAPACITY>();
+    for (int i = 0; i < KEY_CACHE_DEVICES; i++) {
+      T* context = cache->get(i, inputPool[i].key);
+      benchSetSize(*context, sizeof(buffer));
+    }
+    unsigned long hits = cache->hitCount();
+    unsigned long misses = cache->missCount();
+    for (int i = 0; i < numIterations; i++) {
+      const InputSlot& device = inputPool[i % KEY_CACHE_DEVICES];
+      memcpy(buffer, inputPool[i].plaintext, sizeof(buffer));
+
+      unsigned long start = Timer::now();
+      T* context = cache->get(i % KEY_CACHE_DEVICES, device.key);
+      benchSetIV(*context);
+      benchEncrypt(*context, buffer, buffer, sizeof(buffer));
+      cachedTime[i] = Timer::now() - start;
+    }
+    hits = cache->hitCount() - hits;
+    misses = cache->missCount() - misses;
+    delete cache;
+
+    Stats stats;
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    Serial.println("Rekey Per Message Time");
+    computeStats(rekeyTime, numIterations, stats);
+    printStats(stats, sizeof(buffer));
+    Serial.println("Cached Key Time");
+    computeStats(cachedTime, numIterations, stats);
+    printStats(stats, sizeof(buffer));
+    Serial.print("Key Cache: ");
+    Serial.print(hits);
+    Serial.print(" hits, ");
+    Serial.print(misses);
+    Serial.println(" misses");
+    Serial.println();
+  }
+};
 
-    unsigned long time = micros() - start;
-    individualEncryptDecryptTime[i] = time;
-    totalEncryptDecryptTime += time;
+// One GCM message (setIV, encrypt, computeTag) per sample for payloads from
+// 16 bytes to 8 KiB; throughput is taken from the median. The object size
+// includes the per-key tables of TableGCM.
+struct GCMExperiment {
+  TestVector* test;
+  unsigned long individualMessageTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    byte tag[16];
+    char label[24];
+
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    Serial.print("Object Size: ");
+    Serial.print((unsigned long)sizeof(cipher));
+    Serial.println(" bytes");
+
+    benchSetKey(cipher, benchKey);
+    for (unsigned int s = 0; s < sizeof(gcmSizeArray) / sizeof(gcmSizeArray[0]);
+         s++) {
+      size_t len = gcmSizeArray[s];
+      for (int i = 0; i < numIterations; i++) {
+        crypto_feed_watchdog();
+
+        unsigned long start = Timer::now();
+        benchSetIV(cipher);
+        cipher.encrypt(test->ciphertext, test->plaintext, len);
+        cipher.computeTag(tag, sizeof(tag));
+        individualMessageTime[i] = Timer::now() - start;
+      }
+
+      Stats stats;
+      computeStats(individualMessageTime, numIterations, stats);
+      snprintf(label, sizeof(label), "%u bytes", (unsigned)len);
+      printThroughput(label, len, (unsigned long)stats.median);
+    }
+    Serial.println();
   }
-}
+};
 
-void runExperimentXTS192(XTS<AES192>& cipher, struct TestVector* test,
-                         unsigned long& totalEncryptDecryptTime,
-                         unsigned long* individualEncryptDecryptTime) {
-  crypto_feed_watchdog();
+// One sector per sample, encrypted and then decrypted under its own tweak
+// (the sector number, little-endian, as on a disk), for every sector size;
+// throughput is taken from the medians. Every sector has to decrypt back to
+// the plaintext.
+struct XTSExperiment {
+  TestVector* test;
+  unsigned long individualEncryptTime[numIterations];
+  unsigned long individualDecryptTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    byte tweak[16];
+    char label[32];
+
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    benchSetKey(cipher, benchKey);
+    for (unsigned int s = 0;
+         s < sizeof(xtsSectorSizeArray) / sizeof(xtsSectorSizeArray[0]); s++) {
+      size_t len = xtsSectorSizeArray[s];
+      unsigned long roundTripErrors = 0;
+      byte* decrypted = test->plaintext + len;
+      benchSetSize(cipher, len);
+      memset(tweak, 0, sizeof(tweak));
+      for (int i = 0; i < numIterations; i++) {
+        tweak[0] = (byte)i;
+        tweak[1] = (byte)(i >> 8);
+        crypto_feed_watchdog();
+
+        unsigned long start = Timer::now();
+        cipher.setTweak(tweak, sizeof(tweak));
+        cipher.encryptSector(test->ciphertext, test->plaintext);
+        individualEncryptTime[i] = Timer::now() - start;
+
+        start = Timer::now();
+        cipher.setTweak(tweak, sizeof(tweak));
+        cipher.decryptSector(decrypted, test->ciphertext);
+        individualDecryptTime[i] = Timer::now() - start;
+
+        if (memcmp(decrypted, test->plaintext, len) != 0) {
+          roundTripErrors++;
+        }
+      }
+
+      Stats stats;
+      computeStats(individualEncryptTime, numIterations, stats);
+      snprintf(label, sizeof(label), "Encrypt %u bytes", (unsigned)len);
+      printThroughput(label, len, (unsigned long)stats.median);
+      computeStats(individualDecryptTime, numIterations, stats);
+      snprintf(label, sizeof(label), "Decrypt %u bytes", (unsigned)len);
+      printThroughput(label, len, (unsigned long)stats.median);
+      if (roundTripErrors != 0) {
+        Serial.print("Round Trip Errors: ");
+        Serial.println(roundTripErrors);
+      }
+    }
+    Serial.println();
+  }
+};
 
-  for (int i = 0; i < numIterations; i++) {
-    unsigned long start = micros();
+// Batched CTR keystream against CTR<> per payload size: median time of one
+// encrypt() call as throughput, plus the speedup over the CTRMode cell of
+// the same cipher, which BatchSuite runs first.
+struct BatchCTRExperiment {
+  TestVector* test;
+  unsigned long individualMessageTime[numIterations];
+  // Reference medians per cipher (in BatchSuite order) and payload size.
+  double reference[numBatchCiphers][numBatchSizes];
+  int cell;
+
+  BatchCTRExperiment() : cell(0) {}
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    // Cells come mode-major, so the CTR references come first.
+    bool isReference = cell < numBatchCiphers;
+    double* medians = reference[cell % numBatchCiphers];
+    char label[24];
+    cell++;
+
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    benchSetKey(cipher, benchKey);
+    for (int s = 0; s < numBatchSizes; s++) {
+      size_t len = batchSizeArray[s];
+      benchWarmup(cipher, test->ciphertext, test->plaintext, len);
+      for (int i = 0; i < numIterations; i++) {
+        crypto_feed_watchdog();
+        benchSetIV(cipher);
+
+        unsigned long start = Timer::now();
+        cipher.encrypt(test->ciphertext, test->plaintext, len);
+        individualMessageTime[i] = Timer::now() - start;
+      }
+
+      Stats stats;
+      computeStats(individualMessageTime, numIterations, stats);
+      snprintf(label, sizeof(label), "%u bytes", (unsigned)len);
+      printThroughput(label, len, (unsigned long)stats.median);
+      if (isReference) {
+        medians[s] = stats.median;
+      } else if (stats.median > 0) {
+        Serial.print("Gain over CTR: ");
+        Serial.print(medians[s] / stats.median, 2);
+        Serial.println("x");
+      }
+    }
+    Serial.println();
+  }
+};
 
-    setRandomPlaintext(test->plaintext, test->plaintextSize);
+// Latency of one message (IV setup and encryption) for every size of the
+// payload sweep, one "Curve: bytes, median us, p95 us" line per size.
+// tools/results.py curves fits the fixed cost per call and the cost per
+// byte to these lines and shows what a tail byte past a block costs.
+struct PayloadSweepExperiment {
+  TestVector* test;
+  unsigned long individualMessageTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    benchSetKey(cipher, benchKey);
+    for (size_t len = payloadSweepFirst(); len != 0;
+         len = payloadSweepNext(len)) {
+      benchWarmup(cipher, test->ciphertext, test->plaintext, len);
+      for (int i = 0; i < numIterations; i++) {
+        crypto_feed_watchdog();
+
+        unsigned long start = Timer::now();
+        benchSetIV(cipher);
+        benchEncrypt(cipher, test->ciphertext, test->plaintext, len);
+        individualMessageTime[i] = Timer::now() - start;
+      }
+
+      Stats stats;
+      computeStats(individualMessageTime, numIterations, stats);
+      Serial.print("Curve: ");
+      Serial.print((unsigned long)len);
+      Serial.print(", ");
+      Serial.print(Timer::toMicros(stats.median), 3);
+      Serial.print(", ");
+      Serial.println(Timer::toMicros(stats.p95), 3);
+    }
+    Serial.println();
+  }
+};
 
-    cipher.setKey(test->key, cipher.keySize());
-    cipher.encryptSector(buffer, buffer);
-    cipher.decryptSector(buffer, buffer);
+// One message (IV setup and encryption) per sample with input and output
+// at each offset from the arena's 16-byte alignment, in place and into a
+// separate buffer at the same offset; throughput from the medians, and the
+// slowdown against the aligned in-place and out-of-place runs.
+struct AlignmentExperiment {
+  TestVector* test;
+  unsigned long individualMessageTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    const size_t numOffsets =
+        sizeof(alignmentOffsetArray) / sizeof(alignmentOffsetArray[0]);
+    double aligned[2] = {0, 0};
+
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    benchSetKey(cipher, benchKey);
+    for (size_t o = 0; o < numOffsets; o++) {
+      size_t offset = alignmentOffsetArray[o];
+      byte* input = test->plaintext + offset;
+      double inPlace = run(cipher, offset, "In Place", input, input);
+      double outOfPlace = run(cipher, offset, "Out of Place",
+                              test->ciphertext + offset, input);
+      if (o == 0) {
+        aligned[0] = inPlace;
+        aligned[1] = outOfPlace;
+      } else if (aligned[0] > 0 && aligned[1] > 0) {
+        // A coarse timer can give a median of 0 for the aligned runs.
+        Serial.print("Slowdown over Offset 0: ");
+        Serial.print(inPlace / aligned[0], 2);
+        Serial.print("x in place, ");
+        Serial.print(outOfPlace / aligned[1], 2);
+        Serial.println("x out of place");
+      }
+    }
+    Serial.println();
+  }
 
-    unsigned long time = micros() - start;
-    individualEncryptDecryptTime[i] = time;
-    totalEncryptDecryptTime += time;
+  // Median ticks of one message at the given buffers.
+  template <typename T>
+  double run(T& cipher, size_t offset, const char* placement, byte* output,
+             byte* input) {
+    const size_t len = ALIGNMENT_TEST_SIZE;
+    char label[40];
+
+    benchWarmup(cipher, output, input, len);
+    for (int i = 0; i < numIterations; i++) {
+      crypto_feed_watchdog();
+
+      unsigned long start = Timer::now();
+      benchSetIV(cipher);
+      benchEncrypt(cipher, output, input, len);
+      individualMessageTime[i] = Timer::now() - start;
+    }
+
+    Stats stats;
+    computeStats(individualMessageTime, numIterations, stats);
+    snprintf(label, sizeof(label), "Offset %u %s", (unsigned)offset,
+             placement);
+    printThroughput(label, len, (unsigned long)stats.median);
+    return stats.median;
   }
-}
+};
 
-void runExperimentXTS256(XTS<AES256>& cipher, struct TestVector* test,
-                         unsigned long& totalEncryptDecryptTime,
-                         unsigned long* individualEncryptDecryptTime) {
-  crypto_feed_watchdog();
+// Streams len bytes of the test vector through each cell instead of the
+// 16-byte buffer, once in place and once into a separate output buffer. The
+// test vector has to hold the largest size of the suite.
+struct ThroughputExperiment {
+  TestVector* test;
+
+  template <typename T>
+  void operator()(T& cipher, const char* name, size_t len) {
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    Serial.print("Plain Text Size: " + String(len) + "\n");
+
+    XorShift32 rng;
+    rng.fill(test->plaintext, len);
+    benchSetSize(cipher, len);
+    benchSetKey(cipher, benchKey);
+
+    run(cipher, "In Place", test->plaintext, len);
+    run(cipher, "Out of Place", test->ciphertext, len);
+    Serial.println();
+  }
 
-  for (int i = 0; i < numIterations; i++) {
-    unsigned long start = micros();
+  template <typename T>
+  void run(T& cipher, const char* placement, byte* output, size_t len) {
+    unsigned long bytes = (unsigned long)len * numThroughputIterations;
+    char label[40];
+
+    benchSetIV(cipher);
+    unsigned long start = Timer::now();
+    for (int i = 0; i < numThroughputIterations; i++) {
+      benchEncrypt(cipher, output, test->plaintext, len);
+    }
+    unsigned long encryptionTime = Timer::now() - start;
+    crypto_feed_watchdog();
+
+    benchSetIV(cipher);
+    start = Timer::now();
+    for (int i = 0; i < numThroughputIterations; i++) {
+      benchDecrypt(cipher, test->plaintext, output, len);
+    }
+    unsigned long decryptionTime = Timer::now() - start;
+    crypto_feed_watchdog();
+
+    snprintf(label, sizeof(label), "%s Encryption Throughput", placement);
+    printThroughput(label, bytes, encryptionTime);
+    snprintf(label, sizeof(label), "%s Decryption Throughput", placement);
+    printThroughput(label, bytes, decryptionTime);
+  }
+};
 
-    setRandomPlaintext(test->plaintext, test->plaintextSize);
+void setup() {
+  Serial.begin(BENCH_SERIAL_BAUD);
+  Timer::begin();
+  printTimerInfo();
+#if BENCH_TTABLE_AES
+  printTTableAESInfo();
+#endif
+#if BENCH_AESNI
+  printAESNIInfo();
+#endif
+  resultStream.begin();
+  inputPool.fill();
+  resizeTestVector(&testVector, testSize);
+  printHeapReport("Before Run");
+
+  // The experiments hold their sample arrays, several KB together; static
+  // keeps them off the ESP8266's 4 KB loop stack.
+  static Experiment experiment;
+
+  static ThroughputExperiment throughput;
+  throughput.test = &testVector;
+
+  // Runs first so that the first cell really starts from a cold boot.
+  static ColdStartExperiment coldStart;
+  Serial.print("Cold Start Test\n");
+  Suite::run(coldStart);
+
+  // Once per cell before the timed tests, but after the cold start test so
+  // that it does not warm the first cell up.
+  static VerifyExperiment verify;
+  verify.test = &testVector;
+  resizeTestVector(&testVector, messageTestSize);
+  Serial.print("Cross-Check\n");
+  Suite::run(verify);
+  BitsliceSuite::run(verify);
+  BatchSuite::run(verify);
+  GCMSuite::run(verify);
+
+  static KeyCacheExperiment keyCache;
+  Serial.print("Key Cache Test\n");
+  Suite::run(keyCache);
+
+  static GCMExperiment gcm;
+  gcm.test = &testVector;
+  resizeTestVector(&testVector, messageTestSize);
+  XorShift32 rng;
+  rng.fill(testVector.plaintext, testVector.plaintextSize);
+  Serial.print("GHASH Table Test\n");
+  GCMSuite::run(gcm);
+
+  static BatchCTRExperiment batch;
+  batch.test = &testVector;
+  Serial.print("Batch CTR Test\n");
+  BatchSuite::run(batch);
+
+  // Sectors are decrypted into the second half of the plaintext buffer.
+  static XTSExperiment xts;
+  xts.test = &testVector;
+  Serial.print("XTS Sector Test\n");
+  XTSSuite::run(xts);
+
+  static PayloadSweepExperiment sweep;
+  sweep.test = &testVector;
+  resizeTestVector(&testVector, PAYLOAD_SWEEP_MAX);
+  rng.fill(testVector.plaintext, testVector.plaintextSize);
+  Serial.print("Payload Sweep Test\n");
+  Suite::run(sweep);
+
+  static AlignmentExperiment alignment;
+  alignment.test = &testVector;
+  resizeTestVector(&testVector, ALIGNMENT_TEST_SIZE + maxAlignmentOffset);
+  rng.fill(testVector.plaintext, testVector.plaintextSize);
+  Serial.print("Alignment Test\n");
+  Suite::run(alignment);
+  BitsliceSuite::run(alignment);
+
+  // Times the 16-byte buffer, so it runs once; only the throughput pass
+  // below uses the test vector sizes.
+  Serial.print("Single Block Test\n");
+  Suite::run(experiment);
+
+  resizeTestVector(&testVector, maxSize(testSizeArray));
+  Serial.print("Throughput Test\n");
+  ThroughputSuite::run(throughput);
+  BitsliceThroughputSuite::run(throughput);
+  printHeapReport("After Run");
+  printArenaReport(arena);
+  Serial.print("Done\n");
+}
 
-    cipher.setKey(test->key, cipher.keySize());
-    cipher.encryptSector(buffer, buffer);
-    cipher.decryptSector(buffer, buffer);
+void loop() {}
 
-    unsigned long time = micros() - start;
-    individualEncryptDecryptTime[i] = time;
-    totalEncryptDecryptTime += time;
-  }
-}
+void printResults(const char* algorithm, unsigned long* individualSetKeyTime,
+                  unsigned long* individualSetIVTime,
+                  unsigned long* individualEncryptionTime,
+                  unsigned long* individualDecryptionTime,
+                  const Footprint& footprint) {
+  Stats stats;
 
-void printResults(const char* algorithm,
-                  unsigned long totalEncryptDecryptTime) {
   Serial.print("Algorithm: ");
   Serial.println(algorithm);
-  Serial.print("Average EncryptDecrypt Time: ");
-  Serial.print(totalEncryptDecryptTime / numIterations);
-  Serial.println(" microseconds");
+  printFootprint(footprint);
+  Serial.println("Set Key Time");
+  computeStats(individualSetKeyTime, numIterations, stats);
+  printStats(stats, 0);
+  if (individualSetIVTime != NULL) {
+    Serial.println("Set IV Time");
+    computeStats(individualSetIVTime, numIterations, stats);
+    printStats(stats, 0);
+  }
+  Serial.println("Encryption Time");
+  computeStats(individualEncryptionTime, numIterations, stats);
+  printStats(stats, sizeof(buffer));
+  Serial.println("Decryption Time");
+  computeStats(individualDecryptionTime, numIterations, stats);
+  printStats(stats, sizeof(buffer));
   Serial.println();
 }
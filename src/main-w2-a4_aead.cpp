@@ -0,0 +1,194 @@
+#include <Arduino.h>
+
+#include "Bench.h"
+#include "InputPool.h"
+#include "ResultStream.h"
+#include "Stats.h"
+
+// Full seal/open path of the AEAD modes: setIV, addAuthData, encrypt or
+// decrypt, computeTag or checkTag, over a sweep of payload and AAD sizes.
+typedef Matrix<Modes<EAXMode, GCMMode>, Ciphers<BENCH_CIPHERS>> Suite;
+
+size_t payloadSizeArray[] = {16, 64, 256, 1024, 4096};
+
+// 13 bytes is the AAD of a TLS 1.2 record (sequence number and header).
+size_t aadSizeArray[] = {0, 13, 64, 256};
+
+const size_t maxPayloadSize = 4096;
+const size_t maxAadSize = 256;
+
+byte plaintext[maxPayloadSize];
+byte ciphertext[maxPayloadSize];
+byte decrypted[maxPayloadSize];
+byte aad[maxAadSize];
+byte tag[16];
+
+const int numIterations = 100;
+
+InputPool<> inputPool;
+
+void printResults(const char* algorithm, size_t payloadSize, size_t aadSize,
+                  unsigned long* individualSealTime,
+                  unsigned long* individualOpenTime,
+                  unsigned long* individualRejectTime,
+                  unsigned long tagErrors);
+
+template <typename T>
+void sealMessage(T& cipher, const byte* nonce, size_t payloadSize,
+                 size_t aadSize) {
+  cipher.setIV(nonce, cipher.ivSize());
+  if (aadSize > 0) {
+    cipher.addAuthData(aad, aadSize);
+  }
+  cipher.encrypt(ciphertext, plaintext, payloadSize);
+  cipher.computeTag(tag, cipher.tagSize());
+}
+
+template <typename T>
+bool openMessage(T& cipher, const byte* nonce, size_t payloadSize,
+                 size_t aadSize) {
+  cipher.setIV(nonce, cipher.ivSize());
+  if (aadSize > 0) {
+    cipher.addAuthData(aad, aadSize);
+  }
+  cipher.decrypt(decrypted, ciphertext, payloadSize);
+  return cipher.checkTag(tag, cipher.tagSize());
+}
+
+struct Experiment {
+  unsigned long individualSealTime[numIterations];
+  unsigned long individualOpenTime[numIterations];
+  unsigned long individualRejectTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    benchSetKey(cipher, benchKey);
+    for (unsigned int p = 0;
+         p < sizeof(payloadSizeArray) / sizeof(payloadSizeArray[0]); p++) {
+      for (unsigned int a = 0;
+           a < sizeof(aadSizeArray) / sizeof(aadSizeArray[0]); a++) {
+        run(cipher, name, payloadSizeArray[p], aadSizeArray[a]);
+      }
+    }
+  }
+
+  template <typename T>
+  void run(T& cipher, const char* name, size_t payloadSize, size_t aadSize) {
+    unsigned long bytes = payloadSize + aadSize;
+    // Wrong tags must be rejected and correct ones accepted.
+    unsigned long tagErrors = 0;
+    char label[40];
+
+    sealMessage(cipher, benchIV, payloadSize, aadSize);
+
+    snprintf(label, sizeof(label), "Seal Time AAD %u", (unsigned)aadSize);
+    resultStream.beginSeries(name, label, bytes);
+    for (int i = 0; i < numIterations; i++) {
+      const byte* nonce = inputPool[i].plaintext;
+      crypto_feed_watchdog();
+
+      unsigned long start = Timer::now();
+      sealMessage(cipher, nonce, payloadSize, aadSize);
+      individualSealTime[i] = Timer::now() - start;
+      resultStream.add(individualSealTime[i]);
+    }
+    resultStream.endSeries();
+
+    // ciphertext and tag are those of the last seal, under the last nonce.
+    const byte* nonce = inputPool[numIterations - 1].plaintext;
+
+    snprintf(label, sizeof(label), "Open Time AAD %u", (unsigned)aadSize);
+    resultStream.beginSeries(name, label, bytes);
+    for (int i = 0; i < numIterations; i++) {
+      crypto_feed_watchdog();
+
+      unsigned long start = Timer::now();
+      bool valid = openMessage(cipher, nonce, payloadSize, aadSize);
+      individualOpenTime[i] = Timer::now() - start;
+      resultStream.add(individualOpenTime[i]);
+      if (!valid) {
+        tagErrors++;
+      }
+    }
+    resultStream.endSeries();
+
+    // Failure path: one flipped tag bit, which a receiver must reject after
+    // doing the same work.
+    snprintf(label, sizeof(label), "Reject Time AAD %u", (unsigned)aadSize);
+    resultStream.beginSeries(name, label, bytes);
+    for (int i = 0; i < numIterations; i++) {
+      tag[i % cipher.tagSize()] ^= 0x01;
+      crypto_feed_watchdog();
+
+      unsigned long start = Timer::now();
+      bool valid = openMessage(cipher, nonce, payloadSize, aadSize);
+      individualRejectTime[i] = Timer::now() - start;
+      resultStream.add(individualRejectTime[i]);
+      if (valid) {
+        tagErrors++;
+      }
+      tag[i % cipher.tagSize()] ^= 0x01;
+    }
+    resultStream.endSeries();
+
+    if (!resultStream.enabled() || tagErrors != 0) {
+      printResults(name, payloadSize, aadSize, individualSealTime,
+                   individualOpenTime, individualRejectTime, tagErrors);
+    }
+  }
+};
+
+void setup() {
+  Serial.begin(BENCH_SERIAL_BAUD);
+  Timer::begin();
+  printTimerInfo();
+#if BENCH_TTABLE_AES
+  printTTableAESInfo();
+#endif
+#if BENCH_AESNI
+  printAESNIInfo();
+#endif
+  resultStream.begin();
+  inputPool.fill();
+
+  XorShift32 rng;
+  rng.fill(plaintext, sizeof(plaintext));
+  rng.fill(aad, sizeof(aad));
+
+  Experiment experiment;
+  Suite::run(experiment);
+  Serial.print("Done\n");
+}
+
+void loop() {}
+
+void printResults(const char* algorithm, size_t payloadSize, size_t aadSize,
+                  unsigned long* individualSealTime,
+                  unsigned long* individualOpenTime,
+                  unsigned long* individualRejectTime,
+                  unsigned long tagErrors) {
+  Stats stats;
+  unsigned long bytes = payloadSize + aadSize;
+
+  Serial.print("Algorithm: ");
+  Serial.println(algorithm);
+  Serial.print("Payload: ");
+  Serial.print((unsigned long)payloadSize);
+  Serial.print(" bytes, AAD: ");
+  Serial.print((unsigned long)aadSize);
+  Serial.println(" bytes");
+  if (tagErrors != 0) {
+    Serial.print("Tag Errors: ");
+    Serial.println(tagErrors);
+  }
+  Serial.println("Seal Time");
+  computeStats(individualSealTime, numIterations, stats);
+  printStats(stats, bytes);
+  Serial.println("Open Time");
+  computeStats(individualOpenTime, numIterations, stats);
+  printStats(stats, bytes);
+  Serial.println("Reject Time");
+  computeStats(individualRejectTime, numIterations, stats);
+  printStats(stats, bytes);
+  Serial.println();
+}
@@ -0,0 +1,241 @@
+#include <Arduino.h>
+
+#include <stdlib.h>
+
+#include "Bench.h"
+#include "InputPool.h"
+#include "ParallelCipher.h"
+#include "ResultStream.h"
+#include "Stats.h"
+
+// Host only: CTR and XTS over large buffers on 1..N threads. Every cell runs
+// each buffer size with 1, 2, 4, ... threads up to PARALLEL_MAX_THREADS and
+// prints the throughput and the speedup over one thread.
+struct ParallelCTRMode {
+  template <typename T>
+  using Of = ParallelCTR<T>;
+  static const char* suffix() { return "-CTR-P"; }
+};
+
+struct ParallelXTSMode {
+  template <typename T>
+  using Of = ParallelXTS<T>;
+  static const char* suffix() { return "-XTS-P"; }
+};
+
+typedef Matrix<Modes<ParallelCTRMode, ParallelXTSMode>,
+               Ciphers<BENCH_CIPHERS>>
+    Suite;
+
+// 0 for one thread per hardware thread.
+#ifndef PARALLEL_MAX_THREADS
+#define PARALLEL_MAX_THREADS 0
+#endif
+
+// Largest buffer; sizes go from 64 KiB up to this in steps of 4.
+#ifndef PARALLEL_MAX_BUFFER
+#define PARALLEL_MAX_BUFFER (1UL << 30)
+#endif
+
+#ifndef PARALLEL_SECTOR_SIZE
+#define PARALLEL_SECTOR_SIZE 4096
+#endif
+
+const size_t minBufferSize = 65536;
+
+// Every timed run encrypts at least this many bytes, so small buffers are
+// measured over many calls.
+const size_t minRunBytes = 64UL << 20;
+
+const int numRuns = 5;
+
+// Bytes compared against the single-threaded modes (less than the smallest
+// buffer); the odd tail gives CTR a short last chunk.
+const size_t verifySize = 15 * PARALLEL_SECTOR_SIZE + 5;
+
+byte* buffer;
+size_t bufferSize;
+size_t maxThreads;
+
+template <typename T>
+void setupCipher(ParallelCTR<T>& cipher) {
+  cipher.setKey(benchKey, cipher.keySize());
+  cipher.setIV(benchIV, cipher.ivSize());
+}
+
+template <typename T>
+void setupCipher(ParallelXTS<T>& cipher) {
+  cipher.setSectorSize(PARALLEL_SECTOR_SIZE);
+  cipher.setKey(benchKey, cipher.keySize());
+  cipher.setTweak(benchIV, cipher.tweakSize());
+}
+
+template <typename T>
+void encryptBuffer(ParallelCTR<T>& cipher, byte* data, size_t len) {
+  cipher.encrypt(data, data, len);
+}
+
+template <typename T>
+void encryptBuffer(ParallelXTS<T>& cipher, byte* data, size_t len) {
+  cipher.encryptSectors(data, data, len);
+}
+
+// Whether the parallel cell encrypts buffer[0, verifySize) like CTR<T>, or
+// its whole sectors like XTS<T> with consecutive tweaks.
+template <typename T>
+bool verifyCipher(ParallelCTR<T>& cipher) {
+  static byte expected[verifySize];
+  CTR<T> reference;
+  reference.setKey(benchKey, reference.keySize());
+  reference.setIV(benchIV, reference.ivSize());
+  reference.encrypt(expected, buffer, verifySize);
+  setupCipher(cipher);
+  cipher.encrypt(buffer, buffer, verifySize);
+  bool ok = memcmp(buffer, expected, verifySize) == 0;
+  setupCipher(cipher);
+  cipher.decrypt(buffer, buffer, verifySize);
+  return ok;
+}
+
+template <typename T>
+bool verifyCipher(ParallelXTS<T>& cipher) {
+  const size_t len = verifySize - verifySize % PARALLEL_SECTOR_SIZE;
+  static byte expected[verifySize];
+  XTS<T> reference;
+  byte tweak[16];
+  reference.setSectorSize(PARALLEL_SECTOR_SIZE);
+  reference.setKey(benchKey, reference.keySize());
+  memcpy(tweak, benchIV, sizeof(tweak));
+  for (size_t offset = 0; offset < len; offset += PARALLEL_SECTOR_SIZE) {
+    reference.setTweak(tweak, sizeof(tweak));
+    reference.encryptSector(expected + offset, buffer + offset);
+    parallelAddLittleEndian(tweak, 1);
+  }
+  setupCipher(cipher);
+  cipher.encryptSectors(buffer, buffer, len);
+  bool ok = memcmp(buffer, expected, len) == 0;
+  setupCipher(cipher);
+  cipher.decryptSectors(buffer, buffer, len);
+  return ok;
+}
+
+// Next thread count after threads: doubling, with maxThreads as the last.
+size_t nextThreads(size_t threads) {
+  if (threads >= maxThreads) {
+    return 0;
+  }
+  return threads * 2 < maxThreads ? threads * 2 : maxThreads;
+}
+
+struct ScalingExperiment {
+  unsigned long individualRunTime[numRuns];
+
+  template <typename P>
+  void operator()(P& cipher, const char* name) {
+    char label[24];
+
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    for (size_t threads = 1; threads != 0; threads = nextThreads(threads)) {
+      cipher.setThreads(threads);
+      if (!verifyCipher(cipher)) {
+        Serial.print("Mismatch with ");
+        Serial.print((unsigned long)threads);
+        Serial.println(" threads");
+      }
+    }
+
+    for (size_t len = minBufferSize; len <= bufferSize; len *= 4) {
+      size_t passes = minRunBytes / len;
+      if (passes == 0) {
+        passes = 1;
+      }
+      double single = 0;
+
+      Serial.print("Buffer Size: ");
+      Serial.print((unsigned long)len);
+      Serial.println(" bytes");
+      for (size_t threads = 1; threads != 0; threads = nextThreads(threads)) {
+        cipher.setThreads(threads);
+        setupCipher(cipher);
+        encryptBuffer(cipher, buffer, len);
+        for (int r = 0; r < numRuns; r++) {
+          unsigned long start = Timer::now();
+          for (size_t p = 0; p < passes; p++) {
+            encryptBuffer(cipher, buffer, len);
+          }
+          individualRunTime[r] = Timer::now() - start;
+        }
+
+        Stats stats;
+        computeStats(individualRunTime, numRuns, stats);
+        snprintf(label, sizeof(label), "%u threads", (unsigned)threads);
+        printThroughput(label, (unsigned long)(len * passes),
+                        (unsigned long)stats.median);
+        if (threads == 1) {
+          single = stats.median;
+        } else if (stats.median > 0) {
+          Serial.print("Speedup over 1 thread: ");
+          Serial.print(single / stats.median, 2);
+          Serial.print("x, ");
+          Serial.print(cipher.stealCount());
+          Serial.println(" steals");
+        }
+      }
+    }
+    cipher.setThreads(1);
+    Serial.println();
+  }
+};
+
+void setup() {
+  Serial.begin(BENCH_SERIAL_BAUD);
+  Timer::begin();
+  printTimerInfo();
+#if BENCH_TTABLE_AES
+  printTTableAESInfo();
+#endif
+#if BENCH_AESNI
+  printAESNIInfo();
+#endif
+
+  maxThreads = PARALLEL_MAX_THREADS;
+  if (maxThreads == 0) {
+    maxThreads = std::thread::hardware_concurrency();
+  }
+  if (maxThreads == 0) {
+    maxThreads = 1;
+  }
+
+  // Halve the largest buffer until it can be allocated.
+  bufferSize = PARALLEL_MAX_BUFFER;
+  buffer = NULL;
+  while (buffer == NULL && bufferSize >= minBufferSize) {
+    buffer = (byte*)malloc(bufferSize);
+    if (buffer == NULL) {
+      bufferSize /= 2;
+    }
+  }
+  if (buffer == NULL) {
+    Serial.println("Out of memory");
+    return;
+  }
+  XorShift32 rng;
+  rng.fill(buffer, bufferSize);
+
+  Serial.print("Threads: up to ");
+  Serial.print((unsigned long)maxThreads);
+  Serial.print(", chunk: ");
+  Serial.print((unsigned long)PARALLEL_CHUNK_SIZE);
+  Serial.print(" bytes, buffer: up to ");
+  Serial.print((unsigned long)bufferSize);
+  Serial.println(" bytes");
+  Serial.println();
+
+  ScalingExperiment experiment;
+  Suite::run(experiment);
+  free(buffer);
+  Serial.print("Done\n");
+}
+
+void loop() {}
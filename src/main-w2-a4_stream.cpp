@@ -0,0 +1,135 @@
+#include <Arduino.h>
+
+#include "Bench.h"
+#include "InputPool.h"
+#include "RecordRing.h"
+#include "ResultStream.h"
+#include "Stats.h"
+
+// Sustained encryption of a sensor record stream: every record is written
+// straight into a RecordRing, encrypted in place and framed; when the ring
+// is full the oldest frames are popped as if the radio had sent them.
+typedef Matrix<Modes<CTRMode, GCMMode>, Ciphers<BENCH_CIPHERS>> Suite;
+
+#ifndef RECORD_RING_SIZE
+#define RECORD_RING_SIZE 4096
+#endif
+
+size_t recordSizeArray[] = {8, 16, 32, 64, 128, 256, 512, 1024, 1500};
+
+const size_t maxRecordSize = 1500;
+
+// reserve() returns NULL for a frame larger than the ring even when it is
+// empty; the largest frame has a 16-byte tag.
+static_assert(RECORD_RING_SIZE >= RECORD_HEADER_SIZE + maxRecordSize + 16,
+              "RECORD_RING_SIZE does not hold the largest frame");
+
+const int numIterations = 100;
+
+// Records per sample, so that the ring wraps around within the sweep.
+const int recordsPerSample = 16;
+
+RecordRing<RECORD_RING_SIZE> ring;
+
+// The sensor reading, and a copy of one frame for the receiver check.
+byte reading[maxRecordSize];
+byte received[RECORD_HEADER_SIZE + maxRecordSize + 16];
+
+struct StreamExperiment {
+  unsigned long individualSampleTime[numIterations];
+
+  template <typename T>
+  void operator()(T& cipher, const char* name) {
+    char label[24];
+
+    Serial.print("Algorithm: ");
+    Serial.println(name);
+    Serial.print("Frame Overhead: ");
+    Serial.print((unsigned long)(RECORD_HEADER_SIZE + recordTagSize(cipher)));
+    Serial.println(" bytes");
+
+    benchSetKey(cipher, benchKey);
+    for (unsigned int s = 0;
+         s < sizeof(recordSizeArray) / sizeof(recordSizeArray[0]); s++) {
+      size_t len = recordSizeArray[s];
+      while (ring.frames() != 0) {
+        ring.pop();
+      }
+      ring.setNonce(benchIV);
+
+      for (int i = 0; i < numIterations; i++) {
+        crypto_feed_watchdog();
+
+        unsigned long start = Timer::now();
+        for (int r = 0; r < recordsPerSample; r++) {
+          byte* record = ring.reserve(cipher, len);
+          while (record == NULL && ring.frames() != 0) {
+            ring.pop();
+            record = ring.reserve(cipher, len);
+          }
+          // Stands in for the sensor driver writing its reading.
+          memcpy(record, reading, len);
+          ring.commit(cipher);
+        }
+        individualSampleTime[i] = Timer::now() - start;
+      }
+
+      Stats stats;
+      computeStats(individualSampleTime, numIterations, stats);
+      snprintf(label, sizeof(label), "%u bytes", (unsigned)len);
+      printThroughput(label, (unsigned long)len * recordsPerSample,
+                      (unsigned long)stats.median);
+      double micros = Timer::toMicros(stats.median);
+      if (micros > 0) {
+        Serial.print("Records per Second: ");
+        Serial.println(recordsPerSample * 1e6 / micros, 0);
+      }
+      if (!checkFrame(cipher, len)) {
+        Serial.println("Frame Check Failed");
+      }
+    }
+    Serial.println();
+  }
+
+  // Whether the oldest frame in the ring opens to the sensor reading.
+  template <typename T>
+  bool checkFrame(T& cipher, size_t len) {
+    size_t frameLen;
+    const byte* frame = ring.front(frameLen);
+    if (frame == NULL || frameLen > sizeof(received)) {
+      return false;
+    }
+    memcpy(received, frame, frameLen);
+    byte* payload;
+    size_t payloadLen;
+    return recordOpen(cipher, benchIV, received, frameLen, payload,
+                      payloadLen) &&
+           payloadLen == len && memcmp(payload, reading, len) == 0;
+  }
+};
+
+void setup() {
+  Serial.begin(BENCH_SERIAL_BAUD);
+  Timer::begin();
+  printTimerInfo();
+#if BENCH_TTABLE_AES
+  printTTableAESInfo();
+#endif
+#if BENCH_AESNI
+  printAESNIInfo();
+#endif
+
+  XorShift32 rng;
+  rng.fill(reading, sizeof(reading));
+
+  Serial.print("Ring Size: ");
+  Serial.print((unsigned long)ring.capacity());
+  Serial.println(" bytes");
+  Serial.println();
+
+  StreamExperiment experiment;
+  Suite::run(experiment);
+  Serial.print("Done\n");
+}
+
+void loop() {}
@@ -4,57 +4,77 @@
 #include <SHA3.h>
 #include <SHA512.h>
 
+#include "Arena.h"
+#include "InputPool.h"
+#include "Stats.h"
+#include "Timer.h"
+
 struct TestVector {
   const char* name;
   size_t plaintextSize;
   int* plaintext;
 };
 
-size_t testSize = 1024;
+const size_t testSize = 1024;
 const size_t numIterations = 100;
 
+// The four plaintexts, instead of four heap blocks.
+Arena<4 * testSize * sizeof(int)> arena;
+
 static TestVector testVectorSHA256 = {.name = "SHA-256",
                                       .plaintextSize = testSize,
-                                      .plaintext = new int[testSize]};
+                                      .plaintext = arena.alloc<int>(testSize)};
 
 static TestVector testVectorSHA512 = {.name = "SHA-512",
                                       .plaintextSize = testSize,
-                                      .plaintext = new int[testSize]};
+                                      .plaintext = arena.alloc<int>(testSize)};
 
-static TestVector testVectorSHA3_256 = {.name = "SHA3-256",
-                                        .plaintextSize = testSize,
-                                        .plaintext = new int[testSize]};
+static TestVector testVectorSHA3_256 = {
+    .name = "SHA3-256",
+    .plaintextSize = testSize,
+    .plaintext = arena.alloc<int>(testSize)};
 
-static TestVector testVectorSHA3_512 = {.name = "SHA3-512",
-                                        .plaintextSize = testSize,
-                                        .plaintext = new int[testSize]};
+static TestVector testVectorSHA3_512 = {
+    .name = "SHA3-512",
+    .plaintextSize = testSize,
+    .plaintext = arena.alloc<int>(testSize)};
 
 unsigned long sha256Times[numIterations];
 unsigned long sha512Times[numIterations];
 unsigned long sha3_256Times[numIterations];
 unsigned long sha3_512Times[numIterations];
 
+XorShift32 rng;
+
 void generateRandomPlaintext(int* plaintext, size_t size) {
-  for (size_t i = 0; i < size; i++) {
-    plaintext[i] = random(0, 256);
-  }
+  rng.fill((byte*)plaintext, size * sizeof(int));
 }
 
 void printAsCSV(const char* name, unsigned long* times) {
   Serial.print(name);
   for (size_t i = 0; i < numIterations; i++) {
     Serial.print(", ");
-    Serial.print(times[i]);
+    Serial.print(Timer::toMicros(times[i]) / 1000, 3);
   }
   Serial.println();
 }
 
+void printResults(const TestVector& testVector, unsigned long* times) {
+  Stats stats;
+  computeStats(times, numIterations, stats);
+
+  Serial.print("Algorithmus: ");
+  Serial.println(testVector.name);
+  printStats(stats, testVector.plaintextSize * sizeof(int));
+  Serial.println();
+}
+
 void runExperiment(Hash& hash, TestVector& testVector, unsigned long* times,
                    size_t iteration) {
   generateRandomPlaintext(testVector.plaintext, testVector.plaintextSize);
 
   // Zeitmessung starten
-  unsigned long startTime = millis();
+  unsigned long startTime = Timer::now();
 
   // Berechne den Hash
   hash.update((uint8_t*)testVector.plaintext,
@@ -63,7 +83,7 @@ void runExperiment(Hash& hash, TestVector& testVector, unsigned long* times,
   hash.finalize(hashValue, sizeof(hash));
 
   // Zeitmessung beenden
-  unsigned long endTime = millis();
+  unsigned long endTime = Timer::now();
 
   // Speichere die Zeit in das Array
   times[iteration] = endTime - startTime;
@@ -71,7 +91,10 @@ void runExperiment(Hash& hash, TestVector& testVector, unsigned long* times,
 
 void setup() {
   Serial.begin(9600);
+  Timer::begin();
   Serial.println("");
+  printTimerInfo();
+  printHeapReport("Before Run");
   Serial.println("Algorithmus, Zeit (ms)");
 
   crypto_feed_watchdog();
@@ -102,6 +125,15 @@ void setup() {
   printAsCSV(testVectorSHA512.name, sha512Times);
   printAsCSV(testVectorSHA3_256.name, sha3_256Times);
   printAsCSV(testVectorSHA3_512.name, sha3_512Times);
+  Serial.println();
+
+  // Zusammenfassung (sortiert die Zeiten)
+  printResults(testVectorSHA256, sha256Times);
+  printResults(testVectorSHA512, sha512Times);
+  printResults(testVectorSHA3_256, sha3_256Times);
+  printResults(testVectorSHA3_512, sha3_512Times);
+  printHeapReport("After Run");
+  printArenaReport(arena);
 }
 
 void loop() {}
@@ -0,0 +1,219 @@
+#include "Arduino.h"
+
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <atomic>
+#include <new>
+
+HardwareSerial Serial;
+
+static uint64_t monotonicNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t bootNanos = monotonicNanos();
+
+uint64_t nanos() { return monotonicNanos() - bootNanos; }
+
+unsigned long micros() { return (unsigned long)(nanos() / 1000ull); }
+
+unsigned long millis() { return (unsigned long)(nanos() / 1000000ull); }
+
+void delay(unsigned long ms) {
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+void delayMicroseconds(unsigned int us) {
+  struct timespec ts;
+  ts.tv_sec = us / 1000000;
+  ts.tv_nsec = (long)(us % 1000000) * 1000L;
+  nanosleep(&ts, NULL);
+}
+
+void yield() {}
+
+long random(long howbig) {
+  if (howbig <= 0) {
+    return 0;
+  }
+  return ::random() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) {
+    return howsmall;
+  }
+  return random(howbig - howsmall) + howsmall;
+}
+
+void randomSeed(unsigned long seed) {
+  if (seed != 0) {
+    srandom(seed);
+  }
+}
+
+int analogRead(uint8_t pin) {
+  (void)pin;
+  return (int)(monotonicNanos() & 0x3FF);
+}
+
+String::String(int value, unsigned char base)
+    : String((long)value, base) {}
+
+String::String(unsigned int value, unsigned char base)
+    : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base) {
+  if (value < 0 && base == DEC) {
+    s = "-" + String(0UL - (unsigned long)value, base).s;
+  } else {
+    s = String((unsigned long)value, base).s;
+  }
+}
+
+String::String(unsigned long value, unsigned char base) {
+  char buf[8 * sizeof(unsigned long) + 1];
+  char* p = &buf[sizeof(buf) - 1];
+  *p = '\0';
+  do {
+    unsigned long digit = value % base;
+    *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    value /= base;
+  } while (value != 0);
+  s = p;
+}
+
+String::String(double value, unsigned char decimalPlaces) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  s = buf;
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::printNumber(unsigned long long value, int base, bool negative) {
+  char buf[8 * sizeof(unsigned long long) + 2];
+  char* p = &buf[sizeof(buf) - 1];
+  *p = '\0';
+  if (base < 2) {
+    base = 10;
+  }
+  do {
+    unsigned long long digit = value % base;
+    *--p = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+    value /= base;
+  } while (value != 0);
+  if (negative) {
+    *--p = '-';
+  }
+  return write(p);
+}
+
+size_t Print::print(unsigned char value, int base) {
+  return printNumber(value, base, false);
+}
+
+size_t Print::print(int value, int base) { return print((long long)value, base); }
+
+size_t Print::print(unsigned int value, int base) {
+  return printNumber(value, base, false);
+}
+
+size_t Print::print(long value, int base) {
+  return print((long long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+  return printNumber(value, base, false);
+}
+
+size_t Print::print(long long value, int base) {
+  if (value < 0 && base == DEC) {
+    return printNumber(0ull - (unsigned long long)value, base, true);
+  }
+  return printNumber((unsigned long long)value, base, false);
+}
+
+size_t Print::print(unsigned long long value, int base) {
+  return printNumber(value, base, false);
+}
+
+size_t Print::print(double value, int digits) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", digits, value);
+  return write(buf);
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buf[256];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buf, sizeof(buf), format, args);
+  va_end(args);
+  if (len < 0) {
+    return 0;
+  }
+  if ((size_t)len >= sizeof(buf)) {
+    len = sizeof(buf) - 1;
+  }
+  return write((const uint8_t*)buf, len);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  return fputc(c, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+  return fwrite(buffer, 1, size, stdout);
+}
+
+void HardwareSerial::flush() { fflush(stdout); }
+
+static std::atomic<size_t> heapInUse(0);
+
+size_t nativeHeapInUse() { return heapInUse.load(); }
+
+// The array and nothrow forms of the standard library end up here.
+void* operator new(size_t size) {
+  void* block = malloc(size != 0 ? size : 1);
+  if (block == NULL) {
+    throw std::bad_alloc();
+  }
+  heapInUse += malloc_usable_size(block);
+  return block;
+}
+
+void operator delete(void* block) noexcept {
+  if (block != NULL) {
+    heapInUse -= malloc_usable_size(block);
+    free(block);
+  }
+}
+
+void operator delete(void* block, size_t size) noexcept {
+  (void)size;
+  operator delete(block);
+}
+
+// The suites do all of their work in setup() and leave loop() empty, so on
+// the host loop() runs once and the process exits.
+int main() {
+  setup();
+  loop();
+  Serial.flush();
+  return 0;
+}
@@ -0,0 +1,149 @@
+// Host-side stand-in for the parts of the Arduino core used by the benchmark
+// suites, so that every main-*.cpp can be built with `platform = native`.
+#ifndef ARDUINO_NATIVE_H
+#define ARDUINO_NATIVE_H
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+// Time since program start, backed by clock_gettime(CLOCK_MONOTONIC).
+unsigned long millis();
+unsigned long micros();
+uint64_t nanos();
+
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+// There is no floating pin on the host; returns low-order clock jitter so
+// that randomSeed(analogRead(0)) still varies between runs.
+int analogRead(uint8_t pin);
+
+// Bytes currently allocated with operator new (usable size of each block),
+// the host's stand-in for ESP.getFreeHeap() in Footprint.h. glibc's
+// mallinfo2() counts blocks parked in its per-thread cache as in use, so a
+// freed and reallocated object would not show up there.
+size_t nativeHeapInUse();
+
+#ifndef crypto_feed_watchdog
+// Crypto.h defines this as a no-op macro for non-ESP8266 targets; this is
+// only needed when Arduino.h is included first.
+inline void crypto_feed_watchdog() {}
+#endif
+
+class String {
+ public:
+  String(const char* str = "") : s(str) {}
+  String(const std::string& str) : s(str) {}
+  explicit String(char c) : s(1, c) {}
+  explicit String(int value, unsigned char base = DEC);
+  explicit String(unsigned int value, unsigned char base = DEC);
+  explicit String(long value, unsigned char base = DEC);
+  explicit String(unsigned long value, unsigned char base = DEC);
+  explicit String(double value, unsigned char decimalPlaces = 2);
+
+  const char* c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.length(); }
+
+  String& operator+=(const String& rhs) {
+    s += rhs.s;
+    return *this;
+  }
+  String& operator+=(const char* rhs) {
+    s += rhs;
+    return *this;
+  }
+
+  friend String operator+(const String& lhs, const String& rhs) {
+    return String(lhs.s + rhs.s);
+  }
+  friend String operator+(const String& lhs, const char* rhs) {
+    return String(lhs.s + rhs);
+  }
+  friend String operator+(const char* lhs, const String& rhs) {
+    return String(lhs + rhs.s);
+  }
+
+ private:
+  std::string s;
+};
+
+class Print {
+ public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buffer, size_t size);
+  size_t write(const char* str) {
+    return write((const uint8_t*)str, strlen(str));
+  }
+
+  size_t print(const char* str) { return write(str); }
+  size_t print(const String& str) { return write(str.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char value, int base = DEC);
+  size_t print(int value, int base = DEC);
+  size_t print(unsigned int value, int base = DEC);
+  size_t print(long value, int base = DEC);
+  size_t print(unsigned long value, int base = DEC);
+  size_t print(long long value, int base = DEC);
+  size_t print(unsigned long long value, int base = DEC);
+  size_t print(double value, int digits = 2);
+
+  size_t println() { return write("\r\n"); }
+  template <typename T>
+  size_t println(const T& value) {
+    size_t n = print(value);
+    return n + println();
+  }
+  template <typename T>
+  size_t println(const T& value, int format) {
+    size_t n = print(value, format);
+    return n + println();
+  }
+
+  size_t printf(const char* format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+ private:
+  size_t printNumber(unsigned long long value, int base, bool negative);
+};
+
+// Serial writes straight to stdout; baud rate is ignored.
+class HardwareSerial : public Print {
+ public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() { flush(); }
+  void flush();
+  operator bool() const { return true; }
+
+  using Print::write;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+};
+
+extern HardwareSerial Serial;
+
+// Provided by the sketch.
+void setup();
+void loop();
+
+#endif
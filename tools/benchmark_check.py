@@ -0,0 +1,76 @@
+# PlatformIO extra script that adds a benchmark-check target to native
+# environments:
+#
+#   pio run -e native-w2-a4 -t benchmark-check
+#
+# runs the suite, turns its output into a dataset with tools/results.py and
+# checks every cell against baselines/<env>.csv with the tolerances from
+# baselines/tolerances.txt. The target fails if a cell got significantly
+# slower than its tolerance allows, and also if the baseline is missing, so a
+# fresh checkout cannot pass by comparing a run against itself. Baselines are
+# machine-specific and recorded on purpose: BENCHMARK_UPDATE=1 in the
+# environment writes or replaces the baseline from the run.
+#
+# Only the CSV sample lines of a suite are checked, so platformio.ini attaches
+# this script to the envs whose suite prints them: native-w1-a6_alt,
+# native-w1-a7_alt, native-w1-a8_alt, native-w2-a4 and native-w2-a6. In w2-a4
+# these are the 16-byte phase series of Suite; the throughput, payload sweep
+# and other tests print summaries only and are not gated.
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+
+Import("env")  # noqa: F821
+
+
+def benchmark_check(target, source, env):
+    project = env.subst("$PROJECT_DIR")
+    sys.path.insert(0, os.path.join(project, "tools"))
+    import results
+
+    pioenv = env.subst("$PIOENV")
+    build = env.subst("$BUILD_DIR")
+    program = env.subst("$BUILD_DIR/${PROGNAME}${PROGSUFFIX}")
+    log = os.path.join(build, "benchmark.log")
+    dataset = os.path.join(build, "benchmark.csv")
+    baseline = os.path.join(project, "baselines", pioenv + ".csv")
+
+    with open(log, "wb") as out:
+        subprocess.run([program], stdout=out, check=True)
+
+    flags = env.GetProjectOption("build_flags", "")
+    if isinstance(flags, list):
+        flags = " ".join(flags)
+    suite = pioenv[len("native-"):] if pioenv.startswith("native-") \
+        else pioenv
+    ingest = results.Ingest(suite, "native", 0, flags)
+    ingest.read(log)
+    if not ingest.samples:
+        print(f"benchmark-check: {pioenv} prints no sample lines")
+        return 1
+    results.write_dataset(ingest.samples, dataset)
+
+    if os.environ.get("BENCHMARK_UPDATE") == "1":
+        os.makedirs(os.path.dirname(baseline), exist_ok=True)
+        shutil.copyfile(dataset, baseline)
+        print(f"benchmark-check: wrote baseline {baseline}")
+        return 0
+    if not os.path.exists(baseline):
+        print(f"benchmark-check: no baseline {baseline}; record one with "
+              f"BENCHMARK_UPDATE=1 pio run -e {pioenv} -t benchmark-check")
+        return 1
+
+    return results.cmd_check(argparse.Namespace(
+        base=baseline, new=dataset, alpha=0.01, tolerance=5,
+        tolerances=os.path.join(project, "baselines", "tolerances.txt"),
+        strict=False))
+
+
+env.AddCustomTarget(  # noqa: F821
+    name="benchmark-check",
+    dependencies="$BUILD_DIR/${PROGNAME}${PROGSUFFIX}",
+    actions=benchmark_check,
+    title="Benchmark Check",
+    description="Run the suite and compare it against its baseline")
@@ -0,0 +1,320 @@
+#!/usr/bin/env python3
+"""Decodes the binary result stream of a RESULT_STREAM=1 build into CSV/JSON.
+
+Reads a capture file, stdin or a serial port (needs pyserial) and writes one
+CSV row per sample or one JSON object per series. Text the sketch printed
+between frames goes to stderr. The wire format is described in
+src/ResultStream.h.
+
+    pio run -e native-w2-a4 -t exec | tools/decode_results.py > w2-a4.csv
+    tools/decode_results.py --port /dev/ttyUSB0 --baud 115200 --json out.json
+    tools/decode_results.py --self-test
+"""
+
+import argparse
+import csv
+import json
+import sys
+import zlib
+
+VERSION = 1
+
+HELLO = 0x01
+SERIES = 0x02
+SAMPLES = 0x03
+END = 0x04
+
+
+class FrameError(Exception):
+    pass
+
+
+def cobs_encode(data):
+    """Encodes like ResultStream::flush(), without the delimiters."""
+    out = bytearray()
+    start = 0
+    while True:
+        end = start
+        while end < len(data) and data[end] != 0 and end - start < 254:
+            end += 1
+        run = end - start
+        out.append(run + 1)
+        out += data[start:end]
+        if end >= len(data):
+            break
+        start = end + 1 if run < 254 else end
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise FrameError("bad COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Reader:
+    def __init__(self, payload):
+        self.data = payload
+        self.pos = 0
+
+    def byte(self):
+        if self.pos >= len(self.data):
+            raise FrameError("truncated frame")
+        value = self.data[self.pos]
+        self.pos += 1
+        return value
+
+    def varint(self):
+        value = 0
+        shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if b < 0x80:
+                return value
+            shift += 7
+            if shift > 35:
+                raise FrameError("varint too long")
+
+    def string(self):
+        length = self.varint()
+        if self.pos + length > len(self.data):
+            raise FrameError("truncated string")
+        text = self.data[self.pos:self.pos + length].decode("utf-8", "replace")
+        self.pos += length
+        return text
+
+    def done(self):
+        return self.pos >= len(self.data)
+
+
+def unframe(chunk):
+    """Returns the payload of one frame, or raises FrameError."""
+    decoded = cobs_decode(chunk)
+    if len(decoded) < 5:
+        raise FrameError("frame too short")
+    payload, crc = decoded[:-4], int.from_bytes(decoded[-4:], "little")
+    if zlib.crc32(payload) & 0xFFFFFFFF != crc:
+        raise FrameError("CRC mismatch")
+    return payload
+
+
+def chunks(stream):
+    """Yields the byte strings between zero delimiters as they arrive."""
+    pending = bytearray()
+    while True:
+        # A serial port returns what is there instead of waiting for 4096.
+        size = max(1, stream.in_waiting) if hasattr(stream, "in_waiting") \
+            else 4096
+        data = stream.read(size)
+        if not data:
+            break
+        pending += data
+        while True:
+            end = pending.find(0)
+            if end < 0:
+                break
+            yield bytes(pending[:end])
+            del pending[:end + 1]
+    if pending:
+        yield bytes(pending)
+
+
+class Decoder:
+    def __init__(self, on_sample, on_text):
+        self.on_sample = on_sample
+        self.on_text = on_text
+        self.ticks_per_micro = 1.0
+        self.cycles_per_tick = 0.0
+        self.timer = "unknown"
+        self.series = {}
+        self.errors = 0
+        self.lost = 0
+
+    def feed(self, chunk):
+        if not chunk:
+            return
+        try:
+            payload = unframe(chunk)
+        except FrameError:
+            if all(32 <= b < 127 or b in b"\t\r\n" for b in chunk):
+                self.on_text(chunk.decode("ascii"))
+            else:
+                self.errors += 1
+            return
+        try:
+            self.handle(Reader(payload))
+        except FrameError:
+            self.errors += 1
+
+    def handle(self, r):
+        kind = r.byte()
+        if kind == HELLO:
+            version = r.varint()
+            if version != VERSION:
+                raise SystemExit(f"unsupported stream version {version}")
+            self.timer = r.string()
+            self.ticks_per_micro = r.varint() / 1000.0 or 1.0
+            self.cycles_per_tick = r.varint() / 1000.0
+        elif kind == SERIES:
+            sid = r.varint()
+            self.series[sid] = {
+                "series": sid,
+                "algorithm": r.string(),
+                "label": r.string(),
+                "bytes": r.varint(),
+                "next": 0,
+            }
+        elif kind == SAMPLES:
+            info = self.series.get(r.varint())
+            if info is None:
+                raise FrameError("samples for unknown series")
+            index = r.varint()
+            if index > info["next"]:
+                self.lost += index - info["next"]
+            value = 0
+            while not r.done():
+                delta = r.varint()
+                delta = (delta >> 1) ^ -(delta & 1)
+                value = (value + delta) & 0xFFFFFFFF
+                self.on_sample(info, index, value)
+                index += 1
+            info["next"] = index
+        elif kind == END:
+            info = self.series.get(r.varint())
+            count = r.varint()
+            if info is not None and count > info["next"]:
+                self.lost += count - info["next"]
+        else:
+            raise FrameError(f"unknown frame type {kind}")
+
+    def micros(self, ticks):
+        return ticks / self.ticks_per_micro
+
+    def cycles(self, ticks):
+        return ticks * self.cycles_per_tick if self.cycles_per_tick else None
+
+
+# Frames around the 254-byte run limit, where an encoder has to tell a run
+# cut by the limit (no implied zero) from one ended by a zero.
+SELF_TEST_FRAMES = [
+    b"",
+    b"\x00",
+    b"\x05\x00",
+    b"\x01" * 253 + b"\x00\x05",
+    b"\x01" * 254,
+    b"\x01" * 254 + b"\x00\x05",
+    b"\x01" * 254 + b"\x00",
+    b"\x01" * 600,
+    bytes(range(256)) * 3,
+]
+
+
+def self_test():
+    """Round-trips SELF_TEST_FRAMES through the COBS encoder and decoder."""
+    failures = 0
+    for frame in SELF_TEST_FRAMES:
+        encoded = cobs_encode(frame)
+        if 0 in encoded or cobs_decode(encoded) != frame:
+            sys.stderr.write(f"COBS round trip failed for {len(frame)} "
+                             f"bytes: {frame[:8].hex()}...\n")
+            failures += 1
+    print(f"{len(SELF_TEST_FRAMES) - failures}/{len(SELF_TEST_FRAMES)} "
+          "COBS frames round-tripped")
+    return 1 if failures else 0
+
+
+def open_input(args):
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            raise SystemExit("--port needs pyserial (pip install pyserial)")
+        return serial.Serial(args.port, args.baud, timeout=args.timeout)
+    if args.input == "-":
+        return sys.stdin.buffer
+    return open(args.input, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("input", nargs="?", default="-",
+                        help="capture file, - for stdin (default)")
+    parser.add_argument("--port", help="read from this serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=30,
+                        help="stop after this many idle seconds on --port")
+    parser.add_argument("--json", metavar="FILE",
+                        help="write series as JSON to FILE instead of CSV")
+    parser.add_argument("-o", "--output", default="-",
+                        help="CSV output file, - for stdout (default)")
+    parser.add_argument("--self-test", action="store_true",
+                        help="round-trip edge-case frames through the COBS "
+                             "encoder and decoder, then exit")
+    args = parser.parse_args()
+
+    if args.self_test:
+        return self_test()
+
+    series = {}
+    writer = None
+    out = None
+    if not args.json:
+        out = sys.stdout if args.output == "-" else \
+            open(args.output, "w", newline="")
+        writer = csv.writer(out)
+        writer.writerow(["series", "algorithm", "label", "bytes", "index",
+                         "ticks", "microseconds", "cycles"])
+
+    def on_sample(info, index, ticks):
+        if writer is not None:
+            cycles = decoder.cycles(ticks)
+            writer.writerow([info["series"], info["algorithm"], info["label"],
+                             info["bytes"], index, ticks,
+                             f"{decoder.micros(ticks):.3f}",
+                             "" if cycles is None else f"{cycles:.0f}"])
+        else:
+            entry = series.setdefault(info["series"], {
+                "algorithm": info["algorithm"],
+                "label": info["label"],
+                "bytes": info["bytes"],
+                "ticks": [],
+            })
+            entry["ticks"].append(ticks)
+
+    def on_text(text):
+        sys.stderr.write(text)
+
+    decoder = Decoder(on_sample, on_text)
+    with open_input(args) as stream:
+        for chunk in chunks(stream):
+            decoder.feed(chunk)
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump({
+                "timer": decoder.timer,
+                "ticksPerMicrosecond": decoder.ticks_per_micro,
+                "cyclesPerTick": decoder.cycles_per_tick,
+                "series": [series[k] for k in sorted(series)],
+            }, f, indent=1)
+    elif out is not sys.stdout:
+        out.close()
+
+    if decoder.errors or decoder.lost:
+        sys.stderr.write(f"{decoder.errors} corrupt frames, "
+                         f"{decoder.lost} samples lost\n")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
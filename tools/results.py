@@ -0,0 +1,467 @@
+#!/usr/bin/env python3
+"""Turns benchmark logs into one typed dataset and compares two datasets.
+
+ingest reads serial logs as the suites print them (e.g. src/w2-a4_gesamt.txt,
+prose with CSV sample lines in between), bare CSV dumps such as
+src/w1-a8_gesamt.csv, and the CSV written by tools/decode_results.py. Every
+sample becomes one row of a long-format CSV dataset:
+
+    source, suite, board, clock_mhz, build_flags, algorithm, mode, key_bits,
+    payload_bytes, label, iteration, time_us
+
+diff compares two datasets cell by cell (suite, algorithm, mode, key size,
+payload, label) and reports the change of the median with a two-sided
+Mann-Whitney U test. check does the same but only lists regressions, cells
+that got significantly slower by more than their tolerance, and exits with
+status 1 if there are any. curves reads the "Curve:" lines of the payload
+sweep in w2-a4 and fits each cell's latency to a fixed cost per call plus a
+cost per byte, along with what one byte past a power of two costs on top.
+
+    tools/results.py ingest src/w2-a4_gesamt.txt --board esp8266 --clock 80 \\
+        -o esp8266.csv
+    tools/results.py ingest log.txt --suite w2-a4 --flags "-O2" -o new.csv
+    tools/results.py diff esp8266.csv new.csv
+    tools/results.py check baselines/native-w2-a4.csv new.csv \
+        --tolerances baselines/tolerances.txt
+    tools/results.py curves log.txt -o curves.csv
+"""
+
+import argparse
+import csv
+import fnmatch
+import math
+import os
+import re
+import sys
+from dataclasses import dataclass, fields
+
+# Unit of the sample lines, bytes per sample and what the samples time for
+# each suite, for sample lines without a label of their own. w2-a6 prints
+# milliseconds and hashes 1024 ints of 4 bytes; the others time 16-byte
+# blocks.
+SUITES = {
+    "w1-a6": ("us", 16, ""),
+    "w1-a6_alt": ("us", 16, "EncryptDecrypt Time"),
+    "w1-a7": ("us", 16, ""),
+    "w1-a7_alt": ("us", 16, "EncryptDecrypt Time"),
+    "w1-a8": ("us", 16, ""),
+    "w1-a8_alt": ("us", 16, "EncryptDecrypt Time"),
+    "w2-a4": ("us", 16, "EncryptDecrypt Time"),
+    "w2-a6": ("ms", 4096, ""),
+    "main": ("us", 16, "EncryptDecrypt Time"),
+}
+
+UNIT_TO_US = {"us": 1.0, "ms": 1000.0}
+
+CELL = ("suite", "algorithm", "mode", "key_bits", "payload_bytes", "label")
+
+
+@dataclass
+class Sample:
+    source: str
+    suite: str
+    board: str
+    clock_mhz: float
+    build_flags: str
+    algorithm: str
+    mode: str
+    key_bits: int
+    payload_bytes: int
+    label: str
+    iteration: int
+    time_us: float
+
+    def cell(self):
+        return tuple(getattr(self, name) for name in CELL)
+
+
+COLUMNS = [f.name for f in fields(Sample)]
+
+NAME_RE = re.compile(r"^(T?AES|AESNI|BSAES)-(\d+)(?:-([A-Z][A-Z0-9-]*))?$")
+# "AES-128-CTR,1.20,1.18,..." or, with the phase the samples time,
+# "AES-128-CTR,Set Key Time,0.52,0.50,...".
+SAMPLE_LINE_RE = re.compile(
+    r"^([A-Za-z][\w-]*)\s*,\s*(?:([A-Za-z][A-Za-z ]*[A-Za-z])\s*,\s*)?"
+    r"(-?\d[\d.,\s-]*)$")
+PAYLOAD_RE = re.compile(r"^Plain Text Size:\s*(\d+)")
+TIMER_RE = re.compile(r"^Timer:\s*(\w+)(?:,\s*([\d.]+)\s*MHz)?")
+ALGORITHM_RE = re.compile(r"^Algorithm:\s*(\S+)")
+CURVE_RE = re.compile(r"^Curve:\s*(\d+)\s*,\s*([\d.]+)\s*,\s*([\d.]+)")
+
+
+def split_name(name):
+    """"AES-192-CTR" -> ("AES", "CTR", 192); block ciphers alone are ECB.
+
+    "TAES-128-GCM-T4" -> ("TAES", "GCM-T4", 128) for the T-table AES,
+    "AESNI-256-XTS" -> ("AESNI", "XTS", 256) for the AES-NI backend and
+    "BSAES-128-CTR" -> ("BSAES", "CTR", 128) for the bitsliced AES.
+    """
+    match = NAME_RE.match(name)
+    if match is None:
+        return name, "", 0
+    return match.group(1), match.group(3) or "ECB", int(match.group(2))
+
+
+def guess_suite(path):
+    base = os.path.basename(path)
+    for suite in sorted(SUITES, key=len, reverse=True):
+        if base.startswith(suite + "_") or base.startswith(suite + "."):
+            return suite
+    return ""
+
+
+class Ingest:
+    def __init__(self, suite, board, clock, flags):
+        self.suite = suite
+        self.board = board
+        self.clock = clock
+        self.flags = flags
+        self.samples = []
+
+    def add(self, source, name, label, payload, values, to_us, clock):
+        algorithm, mode, key_bits = split_name(name)
+        for i, value in enumerate(values):
+            self.samples.append(Sample(
+                source, self.suite, self.board, clock, self.flags, algorithm,
+                mode, key_bits, payload, label, i, value * to_us))
+
+    def log(self, path, lines):
+        """Parses a serial log or a bare CSV dump of sample lines."""
+        unit, payload, label = SUITES.get(self.suite, ("us", 16, ""))
+        to_us = UNIT_TO_US[unit]
+        clock = self.clock
+        # Logs from before the Timer header timed the whole plaintext, so
+        # "Plain Text Size" is the payload of the following samples.
+        text_size = None
+        legacy = True
+        for line in lines:
+            line = line.strip()
+            timer = TIMER_RE.match(line)
+            if timer:
+                legacy = False
+                if timer.group(2) and not clock:
+                    clock = float(timer.group(2))
+                continue
+            size = PAYLOAD_RE.match(line)
+            if size:
+                text_size = int(size.group(1))
+                continue
+            sample = SAMPLE_LINE_RE.match(line)
+            if not sample:
+                continue
+            cells = [c.strip() for c in sample.group(3).split(",")]
+            try:
+                values = [float(c) for c in cells if c]
+            except ValueError:
+                continue
+            bytes_ = text_size if legacy and text_size else payload
+            self.add(path, sample.group(1), sample.group(2) or label, bytes_,
+                     values, to_us, clock)
+
+    def decoded(self, path, rows):
+        """Parses the CSV written by tools/decode_results.py."""
+        series = {}
+        for row in rows:
+            series.setdefault(row["series"], []).append(row)
+        for rows in series.values():
+            first = rows[0]
+            values = [float(r["microseconds"]) for r in rows]
+            clock = self.clock
+            if not clock and first["cycles"] and values[0] > 0:
+                clock = round(float(first["cycles"]) / values[0])
+            self.add(path, first["algorithm"], first["label"],
+                     int(first["bytes"]), values, 1.0, clock)
+
+    def read(self, path):
+        with open(path, "rb") as f:
+            text = f.read().decode("utf-8", "replace")
+        lines = text.splitlines()
+        if lines and lines[0].startswith("series,algorithm,label,"):
+            self.decoded(path, csv.DictReader(lines))
+        else:
+            self.log(path, lines)
+
+
+def write_dataset(samples, path):
+    out = sys.stdout if path == "-" else open(path, "w", newline="")
+    writer = csv.writer(out)
+    writer.writerow(COLUMNS)
+    for s in samples:
+        writer.writerow([getattr(s, c) for c in COLUMNS])
+    if out is not sys.stdout:
+        out.close()
+
+
+def read_dataset(path):
+    types = {f.name: f.type for f in fields(Sample)}
+    samples = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            samples.append(Sample(**{
+                name: types[name](row[name]) if row[name] != "" else
+                types[name]() for name in COLUMNS}))
+    return samples
+
+
+def median(values):
+    ordered = sorted(values)
+    n = len(ordered)
+    mid = n // 2
+    return ordered[mid] if n % 2 else (ordered[mid - 1] + ordered[mid]) / 2
+
+
+def mann_whitney(a, b):
+    """Two-sided p-value of the Mann-Whitney U test, normal approximation
+    with tie correction; fine for the 100-sample series the suites take."""
+    n1, n2 = len(a), len(b)
+    if n1 == 0 or n2 == 0:
+        return 1.0
+    pooled = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+    ranks = [0.0] * len(pooled)
+    ties = 0.0
+    i = 0
+    while i < len(pooled):
+        j = i
+        while j < len(pooled) and pooled[j][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j):
+            ranks[k] = (i + j + 1) / 2
+        t = j - i
+        ties += t ** 3 - t
+        i = j
+    r1 = sum(r for r, (_, group) in zip(ranks, pooled) if group == 0)
+    u = r1 - n1 * (n1 + 1) / 2
+    n = n1 + n2
+    variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+    z = (abs(u - n1 * n2 / 2) - 0.5) / math.sqrt(variance)
+    return math.erfc(max(z, 0) / math.sqrt(2))
+
+
+def group(samples):
+    cells = {}
+    for s in samples:
+        cells.setdefault(s.cell(), []).append(s.time_us)
+    return cells
+
+
+def cell_name(cell):
+    suite, algorithm, mode, key_bits, payload, label = cell
+    name = algorithm if not key_bits else f"{algorithm}-{key_bits}-{mode}"
+    parts = [suite, name, f"{payload}B"] + ([label] if label else [])
+    return " ".join(p for p in parts if p)
+
+
+def compare(base, new, alpha):
+    """Yields (cell, base median, new median, speedup, p, verdict)."""
+    base_cells, new_cells = group(base), group(new)
+    for cell in sorted(set(base_cells) | set(new_cells), key=str):
+        if cell not in base_cells or cell not in new_cells:
+            yield cell, None, None, None, None, \
+                "only in " + ("base" if cell in base_cells else "new")
+            continue
+        a, b = base_cells[cell], new_cells[cell]
+        before, after = median(a), median(b)
+        speedup = before / after if after else float("inf")
+        p = mann_whitney(a, b)
+        if p >= alpha:
+            verdict = "same"
+        else:
+            verdict = "faster" if after < before else "slower"
+        yield cell, before, after, speedup, p, verdict
+
+
+def read_tolerances(path):
+    """Reads "<pattern> <percent>" lines; patterns are fnmatch globs over
+    cell names as diff prints them and the last matching line wins."""
+    tolerances = []
+    with open(path) as f:
+        for line in f:
+            line = line.split("#", 1)[0].strip()
+            if line:
+                pattern, percent = line.rsplit(None, 1)
+                tolerances.append((pattern, float(percent)))
+    return tolerances
+
+
+def tolerance_for(name, tolerances, default):
+    percent = default
+    for pattern, value in tolerances:
+        if fnmatch.fnmatchcase(name, pattern):
+            percent = value
+    return percent
+
+
+def regressions(base, new, alpha, tolerances, default):
+    """Yields (name, base median, new median, allowed percent) for every
+    cell that is significantly slower than its tolerance allows."""
+    for cell, before, after, _, _, verdict in compare(base, new, alpha):
+        if verdict != "slower":
+            continue
+        name = cell_name(cell)
+        percent = tolerance_for(name, tolerances, default)
+        if after > before * (1 + percent / 100):
+            yield name, before, after, percent
+
+
+def read_curves(path):
+    """{algorithm name: [(bytes, median us, p95 us)]} of a payload sweep."""
+    curves = {}
+    name = None
+    with open(path, "rb") as f:
+        for line in f.read().decode("utf-8", "replace").splitlines():
+            line = line.strip()
+            algorithm = ALGORITHM_RE.match(line)
+            if algorithm:
+                name = algorithm.group(1)
+                continue
+            point = CURVE_RE.match(line)
+            if point and name:
+                curves.setdefault(name, []).append(
+                    (int(point.group(1)), float(point.group(2)),
+                     float(point.group(3))))
+    return curves
+
+
+def fit_line(points):
+    """Least-squares intercept and slope of median time over bytes."""
+    n = len(points)
+    mean_x = sum(p[0] for p in points) / n
+    mean_y = sum(p[1] for p in points) / n
+    sxx = sum((p[0] - mean_x) ** 2 for p in points)
+    if sxx == 0:
+        return mean_y, 0.0
+    slope = sum((p[0] - mean_x) * (p[1] - mean_y) for p in points) / sxx
+    return mean_y - slope * mean_x, slope
+
+
+def tail_cost(points, slope):
+    """Mean extra time of 2^k + 1 bytes over 2^k bytes beyond one byte's
+    share of the slope, i.e. the cost of starting another block."""
+    medians = {p[0]: p[1] for p in points}
+    steps = [medians[n + 1] - medians[n] - slope for n in medians
+             if n >= 16 and n & (n - 1) == 0 and n + 1 in medians]
+    return sum(steps) / len(steps) if steps else None
+
+
+def cmd_curves(args):
+    curves = read_curves(args.log)
+    if not curves:
+        sys.stderr.write(f"{args.log}: no Curve lines found\n")
+        return 1
+    print(f"{'cell':<24} {'points':>6} {'fixed us':>10} {'ns/byte':>9} "
+          f"{'tail us':>9}")
+    for name, points in curves.items():
+        fixed, slope = fit_line(points)
+        tail = tail_cost(points, slope)
+        tail_text = f"{tail:>9.3f}" if tail is not None else f"{'':>9}"
+        print(f"{name:<24} {len(points):>6} {fixed:>10.3f} "
+              f"{slope * 1000:>9.2f} {tail_text}")
+    if args.output:
+        with open(args.output, "w", newline="") as out:
+            writer = csv.writer(out)
+            writer.writerow(["algorithm", "mode", "key_bits",
+                             "payload_bytes", "median_us", "p95_us"])
+            for name, points in curves.items():
+                algorithm, mode, key_bits = split_name(name)
+                for point in points:
+                    writer.writerow([algorithm, mode, key_bits] +
+                                    list(point))
+    return 0
+
+
+def cmd_ingest(args):
+    samples = []
+    for path in args.logs:
+        suite = args.suite or guess_suite(path)
+        ingest = Ingest(suite, args.board, args.clock, args.flags)
+        ingest.read(path)
+        if not ingest.samples:
+            sys.stderr.write(f"{path}: no samples found\n")
+        samples += ingest.samples
+    write_dataset(samples, args.output)
+    return 0
+
+
+def cmd_diff(args):
+    base, new = read_dataset(args.base), read_dataset(args.new)
+    print(f"{'cell':<40} {'base us':>10} {'new us':>10} {'speedup':>8} "
+          f"{'p':>8}  verdict")
+    for cell, before, after, speedup, p, verdict in compare(
+            base, new, args.alpha):
+        if before is None:
+            print(f"{cell_name(cell):<40} {'':>10} {'':>10} {'':>8} "
+                  f"{'':>8}  {verdict}")
+            continue
+        print(f"{cell_name(cell):<40} {before:>10.2f} {after:>10.2f} "
+              f"{speedup:>7.3f}x {p:>8.2g}  {verdict}")
+    return 0
+
+
+def cmd_check(args):
+    base, new = read_dataset(args.base), read_dataset(args.new)
+    tolerances = read_tolerances(args.tolerances) if args.tolerances else []
+    missing = set(group(base)) - set(group(new))
+    for cell in sorted(missing, key=str):
+        print(f"missing: {cell_name(cell)}")
+    failed = 0
+    for name, before, after, percent in regressions(
+            base, new, args.alpha, tolerances, args.tolerance):
+        print(f"REGRESSION: {name}: median {before:.2f} -> {after:.2f} us "
+              f"(+{(after / before - 1) * 100:.1f}%, allowed {percent:g}%)")
+        failed += 1
+    print(f"{len(group(base)) - len(missing)} cells checked, "
+          f"{failed} regressions")
+    return 1 if failed or (missing and args.strict) else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    ingest = sub.add_parser("ingest", help="parse logs into a dataset")
+    ingest.add_argument("logs", nargs="+")
+    ingest.add_argument("--suite", default="",
+                        help="suite name (default: from the file name)")
+    ingest.add_argument("--board", default="", help="e.g. esp8266, native")
+    ingest.add_argument("--clock", type=float, default=0,
+                        help="CPU clock in MHz (default: from the log)")
+    ingest.add_argument("--flags", default="", help="build flags of the run")
+    ingest.add_argument("-o", "--output", default="-")
+    ingest.set_defaults(func=cmd_ingest)
+
+    diff = sub.add_parser("diff", help="compare two datasets per cell")
+    diff.add_argument("base")
+    diff.add_argument("new")
+    diff.add_argument("--alpha", type=float, default=0.01,
+                      help="significance level (default 0.01)")
+    diff.set_defaults(func=cmd_diff)
+
+    check = sub.add_parser("check", help="fail on significant slowdowns")
+    check.add_argument("base")
+    check.add_argument("new")
+    check.add_argument("--alpha", type=float, default=0.01,
+                       help="significance level (default 0.01)")
+    check.add_argument("--tolerance", type=float, default=5,
+                       help="allowed slowdown of the median in percent for "
+                       "cells without a tolerances entry (default 5)")
+    check.add_argument("--tolerances", metavar="FILE",
+                       help="per-cell tolerances, see read_tolerances()")
+    check.add_argument("--strict", action="store_true",
+                       help="also fail if cells of the baseline are missing")
+    check.set_defaults(func=cmd_check)
+
+    curves = sub.add_parser("curves",
+                            help="fit latency curves of a payload sweep")
+    curves.add_argument("log")
+    curves.add_argument("-o", "--output",
+                        help="also write the curve points as CSV")
+    curves.set_defaults(func=cmd_curves)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())